@@ -3,6 +3,7 @@
 #include "Hazel/Core/Core.h"
 
 #include "Hazel/Core/Application.h"
+#include "Hazel/Core/JobSystem.h"
 
 #include "Hazel/Core/Log.h"
 
@@ -13,9 +13,16 @@ namespace Hazel
 	{
 		s_Instance = this;
 
+		// JobSystem要在其他子系统之前初始化, 其他子系统的并行部分都依赖它
+		JobSystem::Init();
+
 		m_Window = std::unique_ptr<Hazel::Window>(Hazel::Window::Create());
-		// 这里会设置m_Window里的std::function<void(Event&)>对象, 当接受Event时, 会调用Application::OnEvent函数
-		m_Window->SetEventCallback(std::bind(&Application::OnEvent, this, std::placeholders::_1));
+		// glfw的回调只会把Event放进m_EventQueue, 每帧开始时统一分发:
+		// 先交给按类型注册的监听者, 没被处理的再通过Application::OnEvent传给LayerStack
+		m_Window->SetEventQueue(&m_EventQueue);
+		m_EventQueue.Subscribe<WindowCloseEvent, Application, &Application::OnWindowClose>(this);
+		m_EventQueue.Subscribe<WindowResizedEvent, Application, &Application::OnWindowResized>(this);
+		m_EventQueue.SetFallback<Application, &Application::OnEvent>(this);
 
 		// Application应该自带ImGuiLayer, 这段代码应该放到引擎内部而不是User的Application派生类里
 		m_ImGuiLayer = std::make_shared<ImGuiLayer>();
@@ -24,6 +31,7 @@ namespace Hazel
 
 	Application::~Application()
 	{
+		JobSystem::Shutdown();
 	}
 
 	// 游戏的核心循环
@@ -31,6 +39,15 @@ namespace Hazel
 	{
 		while (m_Running)
 		{
+			// 0. 分发上一帧glfwPollEvents收集到的所有Event, 同一帧里多次的鼠标移动、窗口Resize已经被合并成一个
+			{
+				HAZEL_PROFILE_TIMER("Event Dispatch")
+				m_EventQueue.Dispatch();
+			}
+
+			// 然后执行其他线程提交的、只能在主线程执行的Job(比如GL资源的创建)
+			JobSystem::ExecuteMainThreadJobs();
+
 			{
 				HAZEL_PROFILE_TIMER("Layer Stack Update")
 
@@ -86,22 +103,11 @@ namespace Hazel
 		return m_LayerStack.PopLayer();
 	}
 
-	// 当窗口触发事件时, 会调用此函数
+	// EventQueue分发时, 没有被监听者处理的Event会调用此函数
+	// 窗口关闭和Resize已经作为监听者注册在m_EventQueue里了, 这里只需要传递给layer
 	void Application::OnEvent(Event& e)
 	{
-		EventDispatcher dispatcher(e);
-
-		// 1. 当接受窗口来的Event时, 首先判断是否是窗口关闭的事件
-		// Dispatch函数只有在Event类型跟模板T匹配时, 才响应事件
-		// std::bind其实是把函数和对应的参数绑定的一起
-		dispatcher.Dispatch<WindowCloseEvent>(
-			// std::bind第一个参数是函数指针, 第二个代表的类对象(因为是类的成员函数)
-			// 第三个代表的是放到函数的第一位
-			std::bind(&Application::OnWindowClose, this, std::placeholders::_1));
-		dispatcher.Dispatch<WindowResizedEvent>(
-			std::bind(&Application::OnWindowResized, this, std::placeholders::_1));
-
-		// 2. 否则才传递到layer来执行事件, 逆序遍历是为了让ImGuiLayer最先收到Event
+		// 逆序遍历是为了让ImGuiLayer最先收到Event
 		uint32_t layerCnt = m_LayerStack.GetLayerCnt();
 		for (int i = layerCnt - 1; i >= 0; i--)
 		{
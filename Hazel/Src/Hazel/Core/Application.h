@@ -3,6 +3,7 @@
 #include "Window.h"
 #include "LayerStack.h"
 #include "Event/ApplicationEvent.h"
+#include "Event/EventQueue.h"
 #include "ImGui/ImGuiLayer.h"
 #include "Renderer/Shader.h"
 #include "Renderer/Buffer.h"
@@ -31,8 +32,9 @@ namespace Hazel
 		void PushLayer(std::shared_ptr<Layer> layer);
 		std::shared_ptr<Layer> PopLayer();
 		Window& GetWindow()const { return *m_Window; }
+		EventQueue& GetEventQueue() { return m_EventQueue; }
 
-		void OnEvent(Event& e);			// 此函数绑定到了Window的各种事件上
+		void OnEvent(Event& e);			// EventQueue里没有被监听者处理的Event, 由此函数传给LayerStack
 		bool OnWindowClose(WindowCloseEvent& e);
 		bool OnWindowResized(WindowResizedEvent& e);
 
@@ -40,6 +42,7 @@ namespace Hazel
 		static Application* s_Instance;
 
 	protected:
+		EventQueue m_EventQueue;		// 要在m_Window之前构造、之后析构
 		std::unique_ptr<Window> m_Window;
 		std::shared_ptr<ImGuiLayer> m_ImGuiLayer;
 
@@ -0,0 +1,316 @@
+#include "hzpch.h"
+#include "JobSystem.h"
+#include "Hazel/Debug/Timer.h"
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+namespace Hazel
+{
+	// 每个Worker一个双端队列, Worker自己从尾部存取, 其他线程从头部偷
+	struct WorkerQueue
+	{
+		std::mutex Mutex;
+		std::deque<Job> Jobs;
+	};
+
+	struct JobSystemData
+	{
+		std::vector<std::thread> Workers;
+		std::vector<std::unique_ptr<WorkerQueue>> Queues;
+
+		std::atomic<bool> Running{ false };
+		std::atomic<uint32_t> NextQueue{ 0 };	// 非Worker线程提交Job时, 轮流放到各个Worker的队列里
+		std::atomic<int> PendingJobs{ 0 };
+
+		// 没有Job可做时, Worker线程在这里睡眠
+		std::mutex SleepMutex;
+		std::condition_variable WakeCondition;
+
+		std::mutex MainThreadMutex;
+		std::vector<Job> MainThreadJobs;
+		std::thread::id MainThreadId;
+	};
+
+	static JobSystemData s_Data;
+	static thread_local int s_WorkerIndex = -1;// 主线程和其他非Worker线程为-1
+
+	void JobSystem::Init(uint32_t workerCnt)
+	{
+		if (s_Data.Running)
+			return;
+
+		s_Data.MainThreadId = std::this_thread::get_id();
+		Instrumentor::Get().RegisterThreadName("Main Thread");
+
+		if (workerCnt == 0)
+		{
+			uint32_t cores = std::thread::hardware_concurrency();
+			workerCnt = cores > 1 ? cores - 1 : 1;
+		}
+
+		for (uint32_t i = 0; i < workerCnt; i++)
+			s_Data.Queues.push_back(std::make_unique<WorkerQueue>());
+
+		s_Data.Running = true;
+		for (uint32_t i = 0; i < workerCnt; i++)
+			s_Data.Workers.emplace_back(&JobSystem::WorkerLoop, i);
+
+		CORE_LOG("JobSystem initialized with {0} worker threads", workerCnt);
+	}
+
+	void JobSystem::Shutdown()
+	{
+		if (!s_Data.Running)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(s_Data.SleepMutex);
+			s_Data.Running = false;
+		}
+		s_Data.WakeCondition.notify_all();
+
+		for (std::thread& worker : s_Data.Workers)
+			worker.join();
+
+		s_Data.Workers.clear();
+		s_Data.Queues.clear();
+		s_Data.PendingJobs = 0;
+	}
+
+	void JobSystem::Submit(const std::function<void()>& func, JobCounter* counter, const char* name)
+	{
+		Submit(func, counter, nullptr, name);
+	}
+
+	void JobSystem::Submit(const std::function<void()>& func, JobCounter* counter, JobCounter* dependency, const char* name)
+	{
+		Job job;
+		job.Func = func;
+		job.Name = name;
+		job.Counter = counter;
+
+		if (counter)
+			counter->m_Count.fetch_add(1, std::memory_order_acq_rel);
+
+		if (dependency)
+		{
+			// 检查和挂到m_Dependents上都要在锁内完成, 与FinishJob里的减计数互斥
+			std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+			if (!dependency->IsDone())
+			{
+				dependency->m_Dependents.push_back(std::move(job));
+				return;
+			}
+		}
+
+		Enqueue(std::move(job));
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		bool isMainThread = IsMainThread();
+		while (!counter.IsDone())
+		{
+			// 主线程在等待时, 也要把只能在主线程执行的Job做掉, 否则Worker里等待它们的Job会死锁
+			if (isMainThread)
+				ExecuteMainThreadJobs();
+
+			if (!TryRunOneJob())
+				std::this_thread::yield();
+		}
+
+		// 确保最后一个FinishJob已经释放了counter的锁, 之后调用者才能安全地销毁counter
+		std::lock_guard<std::mutex> lock(counter.m_Mutex);
+	}
+
+	void JobSystem::ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& func, const char* name)
+	{
+		if (count == 0)
+			return;
+
+		// batchSize为0时, 按照线程数自动切分, 每个线程大概分到4块, 方便负载均衡
+		if (batchSize == 0)
+		{
+			size_t threads = (size_t)GetWorkerCount() + 1;
+			batchSize = std::max<size_t>(1, count / (threads * 4));
+		}
+
+		if (count <= batchSize || !s_Data.Running)
+		{
+			func(0, count);
+			return;
+		}
+
+		JobCounter counter;
+		size_t begin = 0;
+		for (; begin + batchSize < count; begin += batchSize)
+		{
+			size_t end = begin + batchSize;
+			Submit([&func, begin, end]() { func(begin, end); }, &counter, name);
+		}
+
+		// 最后一块直接在当前线程执行
+		func(begin, count);
+
+		Wait(counter);
+	}
+
+	void JobSystem::SubmitToMainThread(const std::function<void()>& func, JobCounter* counter, const char* name)
+	{
+		Job job;
+		job.Func = func;
+		job.Name = name;
+		job.Counter = counter;
+
+		if (counter)
+			counter->m_Count.fetch_add(1, std::memory_order_acq_rel);
+
+		std::lock_guard<std::mutex> lock(s_Data.MainThreadMutex);
+		s_Data.MainThreadJobs.push_back(std::move(job));
+	}
+
+	void JobSystem::ExecuteMainThreadJobs()
+	{
+		std::vector<Job> jobs;
+		{
+			std::lock_guard<std::mutex> lock(s_Data.MainThreadMutex);
+			jobs.swap(s_Data.MainThreadJobs);
+		}
+
+		for (Job& job : jobs)
+			Execute(job);
+	}
+
+	uint32_t JobSystem::GetWorkerCount()
+	{
+		return (uint32_t)s_Data.Workers.size();
+	}
+
+	bool JobSystem::IsMainThread()
+	{
+		// 没有初始化时只有一个线程, 当成主线程处理
+		if (!s_Data.Running)
+			return true;
+
+		return std::this_thread::get_id() == s_Data.MainThreadId;
+	}
+
+	void JobSystem::Enqueue(Job&& job)
+	{
+		// 没有初始化JobSystem时(比如一些工具程序), 直接在当前线程执行
+		if (!s_Data.Running)
+		{
+			Execute(job);
+			return;
+		}
+
+		uint32_t queueCnt = (uint32_t)s_Data.Queues.size();
+		uint32_t index = s_WorkerIndex >= 0 ? (uint32_t)s_WorkerIndex : s_Data.NextQueue.fetch_add(1) % queueCnt;
+
+		{
+			std::lock_guard<std::mutex> lock(s_Data.Queues[index]->Mutex);
+			s_Data.Queues[index]->Jobs.push_back(std::move(job));
+		}
+
+		s_Data.PendingJobs.fetch_add(1, std::memory_order_release);
+
+		// 先拿一下锁, 避免Worker检查完条件但还没进入wait时错过这次notify
+		{
+			std::lock_guard<std::mutex> lock(s_Data.SleepMutex);
+		}
+		s_Data.WakeCondition.notify_one();
+	}
+
+	void JobSystem::Execute(Job& job)
+	{
+		{
+			// Timer里记录的是当前线程的id, 所以每个Worker在Chrome Tracing里都是单独的一行
+			HAZEL_PROFILE_TIMER(job.Name)
+			job.Func();
+		}
+
+		FinishJob(job.Counter);
+	}
+
+	void JobSystem::FinishJob(JobCounter* counter)
+	{
+		if (!counter)
+			return;
+
+		std::vector<Job> released;
+		{
+			std::lock_guard<std::mutex> lock(counter->m_Mutex);
+			if (counter->m_Count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				released.swap(counter->m_Dependents);
+		}
+
+		for (Job& job : released)
+			Enqueue(std::move(job));
+	}
+
+	bool JobSystem::TryRunOneJob()
+	{
+		uint32_t queueCnt = (uint32_t)s_Data.Queues.size();
+		if (queueCnt == 0 || s_Data.PendingJobs.load(std::memory_order_acquire) <= 0)
+			return false;
+
+		Job job;
+		bool found = false;
+
+		// 1. 先从自己的队列尾部取
+		if (s_WorkerIndex >= 0)
+		{
+			WorkerQueue& own = *s_Data.Queues[s_WorkerIndex];
+			std::lock_guard<std::mutex> lock(own.Mutex);
+			if (!own.Jobs.empty())
+			{
+				job = std::move(own.Jobs.back());
+				own.Jobs.pop_back();
+				found = true;
+			}
+		}
+
+		// 2. 再从其他队列的头部偷
+		if (!found)
+		{
+			uint32_t start = s_WorkerIndex >= 0 ? (uint32_t)s_WorkerIndex + 1 : 0;
+			for (uint32_t i = 0; i < queueCnt && !found; i++)
+			{
+				WorkerQueue& victim = *s_Data.Queues[(start + i) % queueCnt];
+				std::lock_guard<std::mutex> lock(victim.Mutex);
+				if (!victim.Jobs.empty())
+				{
+					job = std::move(victim.Jobs.front());
+					victim.Jobs.pop_front();
+					found = true;
+				}
+			}
+		}
+
+		if (!found)
+			return false;
+
+		s_Data.PendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::WorkerLoop(uint32_t workerIndex)
+	{
+		s_WorkerIndex = (int)workerIndex;
+		Instrumentor::Get().RegisterThreadName("Worker " + std::to_string(workerIndex));
+
+		while (s_Data.Running)
+		{
+			if (TryRunOneJob())
+				continue;
+
+			std::unique_lock<std::mutex> lock(s_Data.SleepMutex);
+			s_Data.WakeCondition.wait(lock, []()
+				{
+					return !s_Data.Running || s_Data.PendingJobs.load(std::memory_order_acquire) > 0;
+				});
+		}
+	}
+}
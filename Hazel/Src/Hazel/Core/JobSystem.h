@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Hazel
+{
+	class JobCounter;
+
+	struct Job
+	{
+		std::function<void()> Func;
+		const char* Name = "Job";			// 会作为Instrumentor里的名字, 必须是字符串常量
+		JobCounter* Counter = nullptr;
+	};
+
+	// 用来追踪一组Job是否完成: 每提交一个Job计数+1, Job执行完毕-1, 减到0时代表这一组Job都完成了
+	// 提交Job时可以指定依赖的JobCounter, 只有当它减到0以后, Job才会真正进入队列
+	class JobCounter
+	{
+		friend class JobSystem;
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const { return m_Count.load(std::memory_order_acquire) == 0; }
+
+	private:
+		std::atomic<int> m_Count{ 0 };
+
+		// 依赖于此Counter的Job, 在Counter减到0时再放入队列
+		std::mutex m_Mutex;
+		std::vector<Job> m_Dependents;
+	};
+
+	// 基于Work Stealing的Job System, 每个Worker线程有一个自己的双端队列:
+	// Worker从自己队列的尾部取Job(LIFO, cache更友好), 自己的队列空了以后, 从其他Worker队列的头部偷Job
+	// OpenGL相关的调用只能在主线程执行, 这类Job通过SubmitToMainThread提交, 由Application::Run每帧开始时统一执行
+	class JobSystem
+	{
+	public:
+		// workerCnt为0时, 使用hardware_concurrency - 1个Worker线程(主线程自己也会参与执行Job)
+		static void Init(uint32_t workerCnt = 0);
+		static void Shutdown();
+
+		static void Submit(const std::function<void()>& func, JobCounter* counter = nullptr, const char* name = "Job");
+		// dependency对应的Job全部完成以后, 才会开始执行func
+		static void Submit(const std::function<void()>& func, JobCounter* counter, JobCounter* dependency, const char* name = "Job");
+
+		// 阻塞直到counter减为0, 等待期间当前线程也会去执行队列里的Job, 而不是干等
+		static void Wait(JobCounter& counter);
+
+		// 把[0, count)切分成若干个大小为batchSize的区间, 并行执行func(begin, end), 所有区间执行完毕后才返回
+		static void ParallelFor(size_t count, size_t batchSize, const std::function<void(size_t, size_t)>& func, const char* name = "ParallelFor");
+
+		// 只能在主线程执行的Job, 比如GL的调用
+		static void SubmitToMainThread(const std::function<void()>& func, JobCounter* counter = nullptr, const char* name = "MainThreadJob");
+		static void ExecuteMainThreadJobs();
+
+		static uint32_t GetWorkerCount();
+		static bool IsMainThread();
+
+	private:
+		static void Enqueue(Job&& job);
+		static void Execute(Job& job);
+		static void FinishJob(JobCounter* counter);
+		static bool TryRunOneJob();
+		static void WorkerLoop(uint32_t workerIndex);
+	};
+}
@@ -2,6 +2,7 @@
 #include "hzpch.h"
 #include "Core.h"
 #include "Event/Event.h"
+#include "Event/EventQueue.h"
 #include "Renderer/GraphicsContext.h"
 
 namespace Hazel
@@ -22,8 +23,6 @@ namespace Hazel
 	class HAZEL_API Window
 	{
 	public:
-		// Window自带一个回调函数，用来处理从glfw库收到的callback
-		using EventCallbackFn = std::function<void(Event&)>;
 		virtual ~Window() {};
 		virtual int const GetWindowHeight() const = 0;
 		virtual int const GetWindowWidth() const = 0;
@@ -32,7 +31,8 @@ namespace Hazel
 		virtual void OnUpdate() = 0;
 		virtual void OnResized(int width, int height) = 0;
 		virtual void* GetNativeWindow() const = 0;
-		virtual void SetEventCallback(const EventCallbackFn& callback) = 0;
+		// 从glfw库收到的callback会被转换成Event放进这个队列, 由Application在下一帧开始时统一分发
+		virtual void SetEventQueue(EventQueue* queue) = 0;
 
 		static Window* Create(const WindowProps& props = WindowProps());
 		GraphicsContext* m_Context;
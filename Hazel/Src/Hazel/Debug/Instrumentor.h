@@ -1,5 +1,7 @@
 #pragma once
 #include "hzpch.h"
+#include <mutex>
+#include <thread>
 
 namespace Hazel
 {
@@ -11,7 +13,7 @@ namespace Hazel
 		long long End;
 	};
 
-	// Instrumentor是个单例, 但是应该不是线程安全的单例
+	// Instrumentor是个单例, 由于JobSystem的Worker线程也会写入结果, 写文件的操作用mutex保护起来
 	class Instrumentor
 	{
 	public:
@@ -29,22 +31,40 @@ namespace Hazel
 		// 创建一个Stream, 写入对应的Header文件
 		void BeginSession(const std::string& name, const std::string& filepath = "results.json")
 		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
 			m_OutputStream.open(filepath);
 			WriteHeader();
 			m_CurrentSessionName = name;
+
+			// 每个Session都是一个单独的文件, 需要把已经注册过的线程名重新写一遍
+			for (auto& pair : m_ThreadNames)
+				WriteThreadName(pair.first, pair.second);
 		}
 
 		// Stream里写入Footer文件, 结束Stream
 		void EndSession()
 		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
 			WriteFooter();
 			m_OutputStream.close();
 			m_ProfileCount = 0;
 		}
 
+		// 给当前线程起个名字, Chrome Tracing里每个线程会显示为单独的一行(Track)
+		void RegisterThreadName(const std::string& threadName)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			size_t threadId = std::hash<std::thread::id>{}(std::this_thread::get_id());
+			m_ThreadNames[threadId] = threadName;
+
+			if (m_OutputStream.is_open())
+				WriteThreadName(threadId, threadName);
+		}
+
 		// 需要在Timer的析构函数里, 也就是结束计时的时候, 调用函数, 把结果写入stream里
 		void WriteProfile(const ProfileResult& result)
 		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
 			if (m_ProfileCount++ > 0)
 				m_OutputStream << ",";
 
@@ -65,6 +85,23 @@ namespace Hazel
 			m_OutputStream.flush();
 		}
 
+		// Chrome Tracing的Metadata Event, 用于显示线程名
+		void WriteThreadName(size_t threadId, const std::string& threadName)
+		{
+			if (m_ProfileCount++ > 0)
+				m_OutputStream << ",";
+
+			m_OutputStream << "{";
+			m_OutputStream << "\"name\":\"thread_name\",";
+			m_OutputStream << "\"ph\":\"M\",";
+			m_OutputStream << "\"pid\":0,";
+			m_OutputStream << "\"tid\":" << threadId << ",";
+			m_OutputStream << "\"args\":{\"name\":\"" << threadName << "\"}";
+			m_OutputStream << "}";
+
+			m_OutputStream.flush();
+		}
+
 		// 整个JSON文件的Header
 		void WriteHeader()
 		{
@@ -83,6 +120,8 @@ namespace Hazel
 		std::string m_CurrentSessionName;
 		std::ofstream m_OutputStream;
 		int m_ProfileCount;
+		std::mutex m_Mutex;
+		std::unordered_map<size_t, std::string> m_ThreadNames;
 	};
 
 #ifdef HAZEL_PROFILING
@@ -0,0 +1,515 @@
+#include "hzpch.h"
+#include "BinarySceneSerializer.h"
+#include "SceneSerializer.h"
+#include "Scene.h"
+#include "Components/ComponentReflection.h"
+#include "Hazel/Utils/PlatformUtils.h"
+
+namespace Hazel
+{
+	static const uint32_t BINARY_SCENE_MAGIC = 0x42535A48;// "HZSB"
+	static const uint32_t BINARY_SCENE_VERSION = 1;
+	static const size_t BINARY_SCENE_ALIGNMENT = 16;
+	static const uint64_t DENSE_COLUMN = 0;// EntityOffset为0表示所有GameObject都有这个Component, 不存编号
+
+	struct BinarySceneHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t EntityCount;
+		uint32_t BlockCount;
+		uint64_t StringTableOffset;
+		uint64_t StringTableSize;
+	};
+
+	struct BinarySceneBlock
+	{
+		uint32_t Type;// Component名字的hash
+		uint32_t Count;
+		uint32_t Stride;// 一个元素的字节数, 与当前编译的Component大小不一致时拒绝加载, 需要重新烘焙
+		uint32_t Reserved;
+		uint64_t EntityOffset;// uint32_t的GameObject编号数组
+		uint64_t DataOffset;
+	};
+
+	// 字符串表里是一个接一个以'\0'结尾的字符串, Component里存的是字符串在表里的偏移
+	class StringTableBuilder
+	{
+	public:
+		uint32_t Add(const std::string& str)
+		{
+			auto it = m_Offsets.find(str);
+			if (it != m_Offsets.end())
+				return it->second;
+
+			uint32_t offset = (uint32_t)m_Data.size();
+			m_Data.insert(m_Data.end(), str.c_str(), str.c_str() + str.size() + 1);
+			m_Offsets.emplace(str, offset);
+			return offset;
+		}
+
+		const std::vector<char>& GetData() const { return m_Data; }
+
+	private:
+		std::vector<char> m_Data;
+		std::unordered_map<std::string, uint32_t> m_Offsets;
+	};
+
+	// 每种Component在文件里的表示:
+	// - trivially relocatable的Component直接按内存布局写入, 加载时把映射的内存整段交给registry.insert
+	// - 其余的按ComponentReflection里的字段表依次打包, String写成字符串表里的偏移
+	template<class T>
+	constexpr bool IsRawColumn() { return ComponentTraits<T>::TriviallyRelocatable; }
+
+	template<class T>
+	constexpr uint32_t GetColumnStride()
+	{
+		if constexpr (IsRawColumn<T>())
+			return (uint32_t)sizeof(T);
+		else
+			return GetPackedSize<T>();
+	}
+
+	// Raw的Component写入之前的处理, 默认原样写入
+	template<class T>
+	static T CookRaw(const T& com) { return com; }
+
+	// 只保存描述数据, b2Body的位置记到创建b2Body用的位置里, 运行时的指针全部清空
+	static Rigidbody2D CookRaw(const Rigidbody2D& com)
+	{
+		Rigidbody2D res = com;
+		res.DetachBody();
+		res.SetEntity(entt::null);
+		return res;
+	}
+
+	static void PackField(const FieldInfo& field, const void* com, StringTableBuilder& strings, uint8_t* dst)
+	{
+		if (field.Type == FieldType::String)
+		{
+			std::string value;
+			field.Get(com, &value);
+			uint32_t offset = strings.Add(value);
+			memcpy(dst, &offset, sizeof(offset));
+			return;
+		}
+
+		// 其余字段都是POD, 文件里的字段不保证对齐, 经过一个对齐的临时变量中转
+		alignas(16) uint8_t value[16];
+		field.Get(com, value);
+		memcpy(dst, value, GetPackedFieldSize(field.Type));
+	}
+
+	static void UnpackField(const FieldInfo& field, void* com, const char* strings, const uint8_t* src)
+	{
+		if (field.Type == FieldType::String)
+		{
+			uint32_t offset;
+			memcpy(&offset, src, sizeof(offset));
+			std::string value(strings + offset);
+			field.Set(com, &value);
+			return;
+		}
+
+		alignas(16) uint8_t value[16];
+		memcpy(value, src, GetPackedFieldSize(field.Type));
+		field.Set(com, value);
+	}
+
+	// FNV-1a, 用Component注册时的名字, 调整AllComponentTypes的顺序不影响已经烘焙的文件
+	static uint32_t HashComponentName(const char* name)
+	{
+		uint32_t hash = 2166136261u;
+		for (; *name; name++)
+			hash = (hash ^ (uint8_t)*name) * 16777619u;
+		return hash;
+	}
+
+	static size_t AlignUp(size_t v)
+	{
+		return (v + BINARY_SCENE_ALIGNMENT - 1) & ~(BINARY_SCENE_ALIGNMENT - 1);
+	}
+
+	struct CookedColumn
+	{
+		uint32_t Type;
+		uint32_t Stride;
+		std::vector<uint32_t> Indices;
+		std::vector<uint8_t> Data;
+	};
+
+	template<class T>
+	static void CookColumn(const entt::registry& registry, const std::vector<GameObject>& gos, StringTableBuilder& strings, std::vector<CookedColumn>& out)
+	{
+		if constexpr (!IsRawColumn<T>())
+		{
+			static_assert(ComponentReflection<T>::Reflected, "Serializable components must be trivially relocatable or have a ComponentReflection");
+			static_assert(IsPackable<T>(), "Component has fields that cannot be packed into a binary column");
+		}
+
+		CookedColumn column;
+		column.Type = HashComponentName(ComponentTraits<T>::Name);
+		column.Stride = GetColumnStride<T>();
+
+		for (uint32_t i = 0; i < (uint32_t)gos.size(); i++)
+		{
+			const T* com = registry.try_get<T>(gos[i]);
+			if (!com)
+				continue;
+
+			column.Indices.push_back(i);
+			size_t offset = column.Data.size();
+			column.Data.resize(offset + column.Stride);
+			uint8_t* dst = column.Data.data() + offset;
+
+			if constexpr (IsRawColumn<T>())
+			{
+				T cooked = CookRaw(*com);
+				memcpy(dst, &cooked, sizeof(T));
+			}
+			else
+			{
+				for (const FieldInfo& field : ComponentReflection<T>::Fields)
+				{
+					PackField(field, com, strings, dst);
+					dst += GetPackedFieldSize(field.Type);
+				}
+			}
+		}
+
+		if (!column.Indices.empty())
+			out.push_back(std::move(column));
+	}
+
+	void BinarySceneSerializer::Serialize(std::shared_ptr<Scene> scene, std::vector<uint8_t>& out)
+	{
+		Serialize(scene, scene->GetGameObjects(), out);
+	}
+
+	void BinarySceneSerializer::Serialize(std::shared_ptr<Scene> scene, const std::vector<GameObject>& gos, std::vector<uint8_t>& out)
+	{
+		const entt::registry& registry = scene->GetRegistry();
+
+		StringTableBuilder strings;
+		std::vector<CookedColumn> columns;
+		ForEachComponentType(AllComponentTypes{}, [&](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				if constexpr (ComponentTraits<T>::Serializable)
+					CookColumn<T>(registry, gos, strings, columns);
+			});
+
+		// 先算好每一段的偏移, 再整块写入
+		BinarySceneHeader header = {};
+		header.Magic = BINARY_SCENE_MAGIC;
+		header.Version = BINARY_SCENE_VERSION;
+		header.EntityCount = (uint32_t)gos.size();
+		header.BlockCount = (uint32_t)columns.size();
+
+		size_t offset = sizeof(BinarySceneHeader) + columns.size() * sizeof(BinarySceneBlock);
+		offset = AlignUp(offset);
+		header.StringTableOffset = offset;
+		header.StringTableSize = strings.GetData().size();
+		offset = AlignUp(offset + strings.GetData().size());
+
+		std::vector<BinarySceneBlock> blocks(columns.size());
+		for (size_t i = 0; i < columns.size(); i++)
+		{
+			const CookedColumn& column = columns[i];
+			BinarySceneBlock& block = blocks[i];
+			block.Type = column.Type;
+			block.Count = (uint32_t)column.Indices.size();
+			block.Stride = column.Stride;
+			block.Reserved = 0;
+
+			if (block.Count == header.EntityCount)
+				block.EntityOffset = DENSE_COLUMN;
+			else
+			{
+				block.EntityOffset = offset;
+				offset = AlignUp(offset + column.Indices.size() * sizeof(uint32_t));
+			}
+
+			block.DataOffset = offset;
+			offset = AlignUp(offset + column.Data.size());
+		}
+
+		size_t base = out.size();
+		out.resize(base + offset, 0);
+		uint8_t* dst = out.data() + base;
+
+		memcpy(dst, &header, sizeof(header));
+		if (!blocks.empty())
+			memcpy(dst + sizeof(header), blocks.data(), blocks.size() * sizeof(BinarySceneBlock));
+		if (!strings.GetData().empty())
+			memcpy(dst + header.StringTableOffset, strings.GetData().data(), strings.GetData().size());
+
+		for (size_t i = 0; i < columns.size(); i++)
+		{
+			if (blocks[i].EntityOffset != DENSE_COLUMN)
+				memcpy(dst + blocks[i].EntityOffset, columns[i].Indices.data(), columns[i].Indices.size() * sizeof(uint32_t));
+			memcpy(dst + blocks[i].DataOffset, columns[i].Data.data(), columns[i].Data.size());
+		}
+	}
+
+	bool BinarySceneSerializer::Serialize(std::shared_ptr<Scene> scene, const char* path)
+	{
+		std::vector<uint8_t> data;
+		Serialize(scene, data);
+
+		std::ofstream fout(path, std::ios::binary);
+		if (!fout)
+			return false;
+
+		fout.write((const char*)data.data(), data.size());
+		return (bool)fout;
+	}
+
+	// 加载一个数据块需要的信息, 由AllComponentTypes生成, 按Type查找
+	struct ColumnLoader
+	{
+		uint32_t Type;
+		uint32_t Stride;
+		bool(*Validate)(const uint8_t* data, uint32_t count, size_t stringTableSize);
+		void(*Insert)(entt::registry& registry, const entt::entity* first, const entt::entity* last, const uint8_t* data, const char* strings);
+	};
+
+	// Raw的Component加载时不经过任何Set函数, 数量和枚举都要在交给registry之前检查, 否则之后使用时会越界访问
+	// 枚举的范围来自ComponentReflection的字段表, 与YAML加载时的检查是同一份
+	template<class T>
+	static bool ValidateRaw(const T& com)
+	{
+		if constexpr (ComponentReflection<T>::Reflected)
+			return ValidateFields(com);
+		else
+			return true;
+	}
+
+	// 运行时的指针在CookRaw里清空了, 不为空的只可能是损坏或者伪造的文件
+	static bool ValidateRaw(const Rigidbody2D& com)
+	{
+		return ValidateFields(com)
+			&& com.GetVertexCount() <= Rigidbody2D::MaxPolygonVertices
+			&& com.GetBody() == nullptr;
+	}
+
+	// 字符串字段的偏移都要落在字符串表里, 枚举字段要在范围内, Raw的Component逐个调用ValidateRaw
+	template<class T>
+	static bool ValidateColumn(const uint8_t* data, uint32_t count, size_t stringTableSize)
+	{
+		if constexpr (IsRawColumn<T>())
+		{
+			// 与InsertColumn一样, 数据块按BINARY_SCENE_ALIGNMENT对齐, 可以直接当作T的数组
+			const T* components = reinterpret_cast<const T*>(data);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!ValidateRaw(components[i]))
+					return false;
+			}
+			return true;
+		}
+		else
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const uint8_t* src = data + (size_t)i * GetColumnStride<T>();
+				for (const FieldInfo& field : ComponentReflection<T>::Fields)
+				{
+					if (field.Type == FieldType::String)
+					{
+						uint32_t offset;
+						memcpy(&offset, src, sizeof(offset));
+						if (offset >= stringTableSize)
+							return false;
+					}
+					else if (!IsValidFieldValue(field, src))
+						return false;
+					src += GetPackedFieldSize(field.Type);
+				}
+			}
+			return true;
+		}
+	}
+
+	template<class T>
+	static void InsertColumn(entt::registry& registry, const entt::entity* first, const entt::entity* last, const uint8_t* data, const char* strings)
+	{
+		if constexpr (IsRawColumn<T>())
+			registry.insert<T>(first, last, reinterpret_cast<const T*>(data));
+		else
+		{
+			std::vector<T> components(last - first);
+			for (size_t i = 0; i < components.size(); i++)
+			{
+				const uint8_t* src = data + i * GetColumnStride<T>();
+				for (const FieldInfo& field : ComponentReflection<T>::Fields)
+				{
+					UnpackField(field, &components[i], strings, src);
+					src += GetPackedFieldSize(field.Type);
+				}
+			}
+
+			registry.insert<T>(first, last, components.begin());
+		}
+	}
+
+	static const std::vector<ColumnLoader>& GetColumnLoaders()
+	{
+		static std::vector<ColumnLoader> s_Loaders = []()
+		{
+			std::vector<ColumnLoader> res;
+			ForEachComponentType(AllComponentTypes{}, [&res](auto tag)
+				{
+					using T = typename decltype(tag)::Type;
+					if constexpr (ComponentTraits<T>::Serializable)
+						res.push_back({ HashComponentName(ComponentTraits<T>::Name), GetColumnStride<T>(), &ValidateColumn<T>, &InsertColumn<T> });
+				});
+			return res;
+		}();
+
+		return s_Loaders;
+	}
+
+	static const ColumnLoader* FindColumnLoader(uint32_t type)
+	{
+		for (const ColumnLoader& loader : GetColumnLoaders())
+		{
+			if (loader.Type == type)
+				return &loader;
+		}
+		return nullptr;
+	}
+
+	static bool IsRangeValid(uint64_t offset, uint64_t bytes, size_t size)
+	{
+		return offset % BINARY_SCENE_ALIGNMENT == 0 && offset <= size && bytes <= size - offset;
+	}
+
+	bool BinarySceneSerializer::Deserialize(std::shared_ptr<Scene> scene, const char* path)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+		{
+			CORE_LOG_ERROR("Failed to open binary scene: {0}", path);
+			return false;
+		}
+
+		return Deserialize(scene, file.GetData(), file.GetSize());
+	}
+
+	bool BinarySceneSerializer::Deserialize(std::shared_ptr<Scene> scene, const uint8_t* data, size_t size, std::vector<entt::entity>* outEntities)
+	{
+		BinarySceneHeader header;
+		if (size < sizeof(header))
+			return false;
+
+		memcpy(&header, data, sizeof(header));
+		if (header.Magic != BINARY_SCENE_MAGIC || header.Version != BINARY_SCENE_VERSION)
+		{
+			CORE_LOG_ERROR("Binary scene has wrong magic or version, it needs to be cooked again");
+			return false;
+		}
+
+		if (!IsRangeValid(sizeof(header), (uint64_t)header.BlockCount * sizeof(BinarySceneBlock), size)
+			|| !IsRangeValid(header.StringTableOffset, header.StringTableSize, size))
+			return false;
+
+		const BinarySceneBlock* blocks = reinterpret_cast<const BinarySceneBlock*>(data + sizeof(header));
+		const char* strings = reinterpret_cast<const char*>(data + header.StringTableOffset);
+		if (header.StringTableSize > 0 && strings[header.StringTableSize - 1] != '\0')
+			return false;
+
+		// 先校验所有数据块, 出错时Scene保持原样
+		std::vector<const ColumnLoader*> loaders(header.BlockCount);
+		for (uint32_t i = 0; i < header.BlockCount; i++)
+		{
+			const BinarySceneBlock& block = blocks[i];
+			loaders[i] = FindColumnLoader(block.Type);
+
+			// 不认识的Component直接跳过, 旧版本的程序也能加载新增了Component的文件
+			if (!loaders[i])
+				continue;
+
+			if (block.Stride != loaders[i]->Stride || block.Count > header.EntityCount)
+			{
+				CORE_LOG_ERROR("Binary scene was cooked with a different component layout, it needs to be cooked again");
+				return false;
+			}
+
+			// 同一种Component出现在两个数据块里, insert会给同一个entity添加两次
+			if (std::find(loaders.begin(), loaders.begin() + i, loaders[i]) != loaders.begin() + i)
+				return false;
+
+			if (!IsRangeValid(block.DataOffset, (uint64_t)block.Count * block.Stride, size)
+				|| !loaders[i]->Validate(data + block.DataOffset, block.Count, header.StringTableSize))
+				return false;
+
+			if (block.EntityOffset == DENSE_COLUMN)
+			{
+				if (block.Count != header.EntityCount)
+					return false;
+			}
+			else
+			{
+				if (!IsRangeValid(block.EntityOffset, (uint64_t)block.Count * sizeof(uint32_t), size))
+					return false;
+
+				// 写入时索引总是严格递增的, 不递增说明有重复的索引, insert会给同一个entity添加两次
+				const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + block.EntityOffset);
+				for (uint32_t j = 0; j < block.Count; j++)
+				{
+					if (indices[j] >= header.EntityCount || (j > 0 && indices[j] <= indices[j - 1]))
+						return false;
+				}
+			}
+		}
+
+		std::vector<entt::entity> entities(header.EntityCount);
+		entt::registry& registry = scene->GetRegistry();
+		registry.create(entities.begin(), entities.end());
+
+		std::vector<entt::entity> subset;
+		for (uint32_t i = 0; i < header.BlockCount; i++)
+		{
+			const BinarySceneBlock& block = blocks[i];
+			if (!loaders[i] || block.Count == 0)
+				continue;
+
+			const entt::entity* first = entities.data();
+			if (block.EntityOffset != DENSE_COLUMN)
+			{
+				const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + block.EntityOffset);
+				subset.resize(block.Count);
+				for (uint32_t j = 0; j < block.Count; j++)
+					subset[j] = entities[indices[j]];
+				first = subset.data();
+			}
+
+			loaders[i]->Insert(registry, first, first + block.Count, data + block.DataOffset, strings);
+		}
+
+		scene->AddToHierarchy(entities);
+		if (outEntities)
+			outEntities->insert(outEntities->end(), entities.begin(), entities.end());
+		return true;
+	}
+
+	bool BinarySceneSerializer::ConvertYamlToBinary(const char* yamlPath, const char* binaryPath)
+	{
+		std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+		if (!SceneSerializer::Deserialize(scene, yamlPath))
+			return false;
+
+		return Serialize(scene, binaryPath);
+	}
+
+	bool BinarySceneSerializer::ConvertBinaryToYaml(const char* binaryPath, const char* yamlPath)
+	{
+		std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+		if (!Deserialize(scene, binaryPath))
+			return false;
+
+		SceneSerializer::Serialize(scene, yamlPath);
+		return true;
+	}
+}
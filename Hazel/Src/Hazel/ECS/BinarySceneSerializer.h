@@ -0,0 +1,34 @@
+#pragma once
+#include "entt.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Hazel
+{
+	class Scene;
+	class GameObject;
+
+	// 烘焙过的二进制Scene文件(*.hscene), 发布版只加载这种格式, YAML格式(*.scene)留给编辑器和版本管理里做diff
+	// 文件布局(小端, 每个数据块按16字节对齐):
+	//	Header | Block表 | 字符串表 | 每种Component一个列式数据块
+	// 所有GameObject按Hierarchy里的顺序编号, 每个数据块记录拥有该Component的GameObject编号和对应的Component数组
+	// trivially relocatable的Component在文件里就是内存里的样子, 加载时把映射的内存直接交给registry.insert, 不需要解析
+	class BinarySceneSerializer
+	{
+	public:
+		static bool Serialize(std::shared_ptr<Scene> scene, const char* path);
+		static void Serialize(std::shared_ptr<Scene> scene, std::vector<uint8_t>& out);
+		// 只写出gos里的GameObject, WorldPartition用它把Scene切成多个格子文件
+		static void Serialize(std::shared_ptr<Scene> scene, const std::vector<GameObject>& gos, std::vector<uint8_t>& out);
+
+		// 用MappedFile映射整个文件, 校验所有数据块之后再一次性create所有entity, 每种Component整段insert
+		static bool Deserialize(std::shared_ptr<Scene> scene, const char* path);
+		// outEntities不为空时, 追加这次创建的所有entity, 用于之后整体卸载
+		static bool Deserialize(std::shared_ptr<Scene> scene, const uint8_t* data, size_t size, std::vector<entt::entity>* outEntities = nullptr);
+
+		// 两种格式之间的转换, 内部会创建一个临时Scene
+		static bool ConvertYamlToBinary(const char* yamlPath, const char* binaryPath);
+		static bool ConvertBinaryToYaml(const char* binaryPath, const char* yamlPath);
+	};
+}
@@ -26,8 +26,8 @@ namespace Hazel
 		bool& GetFixedAspectRatio() { return m_FixedAspectRatio; }
 		bool IsFixedAspectRatio() const { return m_FixedAspectRatio; }
 
-		ProjectionType GetProjectionType() { return m_ProjectionType; }
-		void SetProjectionType(const ProjectionType& type) { m_ProjectionType = type; }
+		ProjectionType GetProjectionType() const { return m_ProjectionType; }
+		void SetProjectionType(const ProjectionType& type) { m_ProjectionType = type; RecalculateProjectionMat(); }
 
 		float GetPerspectiveVerticalFOV() const { return m_PerspectiveFOV; }
 		void SetPerspectiveVerticalFOV(float verticalFov) { m_PerspectiveFOV = verticalFov; RecalculateProjectionMat(); }
@@ -3,23 +3,10 @@
 
 namespace Hazel
 {
+	// 所有Component的空基类, 只用来做标记
+	// 不能有虚函数, 否则每个Component都会带一个vptr, entt的pool也没法用memcpy来搬运和拷贝
+	// 每个Component都要在ComponentRegistry.h里用HAZEL_REGISTER_COMPONENT注册, 声明它的ComponentTraits
 	class Component
 	{
-	public:
-		Component() = default;
-
-		// Uncopieable but movable
-		Component(const Component&) = delete;
-		Component(Component&&) = default;
-
-		Component& operator=(const Component&) = delete;
-		Component& operator=(Component&&) = default;
-
-		virtual ~Component() = default;
-
-		uint32_t InstanceId = 0;
-
-		//protected:
-		//	std::weak_ptr<GameObject> m_GameObject;
 	};
-}
\ No newline at end of file
+}
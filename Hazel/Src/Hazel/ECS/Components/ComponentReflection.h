@@ -0,0 +1,273 @@
+#pragma once
+#include "ComponentRegistry.h"
+#include "glm/glm.hpp"
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace Hazel
+{
+	// Component字段的值类型, YAML、二进制格式和Inspector都按它来选择读写方式
+	enum class FieldType
+	{
+		Bool,
+		Int,
+		Float,
+		UInt64,
+		Vec2,
+		Vec3,
+		Vec4,
+		String,
+		Vec2List
+	};
+
+	template<class V> struct FieldTypeOf;
+	template<> struct FieldTypeOf<bool> { static constexpr FieldType Value = FieldType::Bool; };
+	template<> struct FieldTypeOf<int> { static constexpr FieldType Value = FieldType::Int; };
+	template<> struct FieldTypeOf<float> { static constexpr FieldType Value = FieldType::Float; };
+	template<> struct FieldTypeOf<uint64_t> { static constexpr FieldType Value = FieldType::UInt64; };
+	template<> struct FieldTypeOf<glm::vec2> { static constexpr FieldType Value = FieldType::Vec2; };
+	template<> struct FieldTypeOf<glm::vec3> { static constexpr FieldType Value = FieldType::Vec3; };
+	template<> struct FieldTypeOf<glm::vec4> { static constexpr FieldType Value = FieldType::Vec4; };
+	template<> struct FieldTypeOf<std::string> { static constexpr FieldType Value = FieldType::String; };
+	template<> struct FieldTypeOf<std::vector<glm::vec2>> { static constexpr FieldType Value = FieldType::Vec2List; };
+
+	enum FieldFlags : uint32_t
+	{
+		FieldFlags_None = 0,
+		FieldFlags_Color = 1 << 0,	// Inspector里用取色器显示
+		FieldFlags_Angle = 1 << 1,	// 存的是弧度, Inspector里按角度显示
+		FieldFlags_DefaultOne = 1 << 2,	// Inspector里的重置按钮恢复成1而不是0, 比如Scale
+	};
+
+	// 描述Component的一个字段, Get把值写到out指向的ValueType里, Set从in指向的ValueType读出新的值
+	// 字段大多是私有的, 通过Component的访问函数读写, 所以这里存的是函数指针而不是偏移
+	struct FieldInfo
+	{
+		const char* Name;
+		FieldType Type;
+		uint32_t Flags;
+		void(*Get)(const void* com, void* out);
+		void(*Set)(void* com, const void* in);
+
+		// 枚举字段(Type为Int)的选项名, 顺序与枚举值相同, 合法的值是[0, EnumCount)
+		const char* const* EnumNames = nullptr;
+		uint32_t EnumCount = 0;
+		// Inspector里拖动Float的范围, 都为0表示不限制
+		float Min = 0.0f, Max = 0.0f;
+		// Inspector里是否显示这个字段, 比如Rigidbody2D的Radius只在Shape为Circle时才有意义, 为空表示总是显示
+		bool(*Visible)(const void* com) = nullptr;
+
+		template<size_t N>
+		constexpr FieldInfo WithEnum(const char* const (&names)[N]) const { FieldInfo f = *this; f.EnumNames = names; f.EnumCount = (uint32_t)N; return f; }
+		constexpr FieldInfo WithRange(float min, float max) const { FieldInfo f = *this; f.Min = min; f.Max = max; return f; }
+		constexpr FieldInfo VisibleIf(bool(*visible)(const void*)) const { FieldInfo f = *this; f.Visible = visible; return f; }
+	};
+
+	// 二进制格式里一个字段占的字节数, String存的是字符串表里的偏移, 变长的Vec2List不能打包
+	constexpr uint32_t GetPackedFieldSize(FieldType type)
+	{
+		switch (type)
+		{
+		case FieldType::Bool:		return 1;
+		case FieldType::Int:		return 4;
+		case FieldType::Float:		return 4;
+		case FieldType::UInt64:		return 8;
+		case FieldType::Vec2:		return 8;
+		case FieldType::Vec3:		return 12;
+		case FieldType::Vec4:		return 16;
+		case FieldType::String:		return 4;
+		default:					return 0;
+		}
+	}
+
+	// 每个需要序列化或者在Inspector里编辑的Component, 用一个特化给出它的字段表, 所有的表都在编译期生成
+	// SerializedName是YAML里这个Component的key, 为空表示字段直接写在GameObject这一层(Name)或者不写入YAML
+	template<class T>
+	struct ComponentReflection
+	{
+		static constexpr bool Reflected = false;
+	};
+
+	// getter和setter里用com表示Component, setter里用value表示新的值; 表达式里有逗号时需要整体加括号
+#define HAZEL_FIELD(ComponentType, name, ValueType, flags, getter, setter)									\
+	FieldInfo{ name, FieldTypeOf<ValueType>::Value, flags,													\
+		[](const void* c, void* v) { const ComponentType& com = *static_cast<const ComponentType*>(c); *static_cast<ValueType*>(v) = (getter); },	\
+		[](void* c, const void* v) { ComponentType& com = *static_cast<ComponentType*>(c); const ValueType& value = *static_cast<const ValueType*>(v); setter; } }
+
+#define HAZEL_MEMBER_FIELD(ComponentType, member, ValueType, flags)											\
+	HAZEL_FIELD(ComponentType, #member, ValueType, flags, com.member, com.member = value)
+
+	// 给FieldInfo::VisibleIf用的条件, condition里用com表示Component
+#define HAZEL_FIELD_CONDITION(ComponentType, condition)														\
+	[](const void* c) { const ComponentType& com = *static_cast<const ComponentType*>(c); return (bool)(condition); }
+
+	template<>
+	struct ComponentReflection<NameComponent>
+	{
+		static constexpr bool Reflected = true;
+		static constexpr const char* SerializedName = "";
+		static constexpr FieldInfo Fields[] =
+		{
+			HAZEL_MEMBER_FIELD(NameComponent, Name, std::string, FieldFlags_None),
+		};
+	};
+
+	template<>
+	struct ComponentReflection<Transform>
+	{
+		static constexpr bool Reflected = true;
+		static constexpr const char* SerializedName = "TransformComponent";
+		static constexpr FieldInfo Fields[] =
+		{
+			HAZEL_MEMBER_FIELD(Transform, Translation, glm::vec3, FieldFlags_None),
+			HAZEL_MEMBER_FIELD(Transform, Rotation, glm::vec3, FieldFlags_Angle),
+			HAZEL_MEMBER_FIELD(Transform, Scale, glm::vec3, FieldFlags_DefaultOne),
+		};
+	};
+
+	template<>
+	struct ComponentReflection<CameraComponent>
+	{
+		static constexpr bool Reflected = true;
+		static constexpr const char* SerializedName = "CameraComponent";
+		static constexpr const char* ProjectionTypeNames[] = { "Perspective", "Orthographic" };
+		static_assert(std::size(ProjectionTypeNames) == (size_t)CameraComponent::ProjectionType::Orthographic + 1, "ProjectionTypeNames is out of date");
+
+		static constexpr FieldInfo Fields[] =
+		{
+			HAZEL_FIELD(CameraComponent, "ProjectionType", int, FieldFlags_None, (int)com.GetProjectionType(), com.SetProjectionType((CameraComponent::ProjectionType)value))
+				.WithEnum(ProjectionTypeNames),
+			HAZEL_FIELD(CameraComponent, "PerspectiveFOV", float, FieldFlags_Angle, com.GetPerspectiveVerticalFOV(), com.SetPerspectiveVerticalFOV(value))
+				.VisibleIf(HAZEL_FIELD_CONDITION(CameraComponent, com.GetProjectionType() == CameraComponent::ProjectionType::Perspective)),
+			HAZEL_FIELD(CameraComponent, "PerspectiveNear", float, FieldFlags_None, com.GetPerspectiveNearClip(), com.SetPerspectiveNearClip(value))
+				.VisibleIf(HAZEL_FIELD_CONDITION(CameraComponent, com.GetProjectionType() == CameraComponent::ProjectionType::Perspective)),
+			HAZEL_FIELD(CameraComponent, "PerspectiveFar", float, FieldFlags_None, com.GetPerspectiveFarClip(), com.SetPerspectiveFarClip(value))
+				.VisibleIf(HAZEL_FIELD_CONDITION(CameraComponent, com.GetProjectionType() == CameraComponent::ProjectionType::Perspective)),
+			HAZEL_FIELD(CameraComponent, "OrthographicSize", float, FieldFlags_None, com.GetOrthographicSize(), com.SetOrthographicSize(value))
+				.VisibleIf(HAZEL_FIELD_CONDITION(CameraComponent, com.GetProjectionType() == CameraComponent::ProjectionType::Orthographic)),
+			HAZEL_FIELD(CameraComponent, "OrthographicNear", float, FieldFlags_None, com.GetOrthographicNearClip(), com.SetOrthographicNearClip(value))
+				.VisibleIf(HAZEL_FIELD_CONDITION(CameraComponent, com.GetProjectionType() == CameraComponent::ProjectionType::Orthographic)),
+			HAZEL_FIELD(CameraComponent, "OrthographicFar", float, FieldFlags_None, com.GetOrthographicFarClip(), com.SetOrthographicFarClip(value))
+				.VisibleIf(HAZEL_FIELD_CONDITION(CameraComponent, com.GetProjectionType() == CameraComponent::ProjectionType::Orthographic)),
+			HAZEL_FIELD(CameraComponent, "FixedAspectRatio", bool, FieldFlags_None, com.IsFixedAspectRatio(), com.GetFixedAspectRatio() = value)
+				.VisibleIf(HAZEL_FIELD_CONDITION(CameraComponent, com.GetProjectionType() == CameraComponent::ProjectionType::Orthographic)),
+		};
+	};
+
+	// Texture目前没有序列化
+	template<>
+	struct ComponentReflection<SpriteRenderer>
+	{
+		static constexpr bool Reflected = true;
+		static constexpr const char* SerializedName = "SpriteRendererComponent";
+		static constexpr FieldInfo Fields[] =
+		{
+			HAZEL_FIELD(SpriteRenderer, "Color", glm::vec4, FieldFlags_Color, com.GetTintColor(), com.GetTintColor() = value),
+			HAZEL_FIELD(SpriteRenderer, "TilingFactor", glm::vec2, FieldFlags_None, com.GetTilingFactor(), com.GetTilingFactor() = value),
+		};
+	};
+
+	// b2Body等运行时数据不在表里, 创建b2Body用的位置和角度来自Transform
+	template<>
+	struct ComponentReflection<Rigidbody2D>
+	{
+		static constexpr bool Reflected = true;
+		static constexpr const char* SerializedName = "Rigidbody2DComponent";
+		static constexpr const char* TypeNames[] = { "Static", "Dynamic", "Kinematic" };
+		static constexpr const char* ShapeNames[] = { "Box", "Circle", "Polygon", "Line" };
+		static_assert(std::size(TypeNames) == (size_t)Rigidbody2DType::Kinematic + 1, "TypeNames is out of date");
+		static_assert(std::size(ShapeNames) == (size_t)Rigidbody2DShape::Line + 1, "ShapeNames is out of date");
+
+		static constexpr FieldInfo Fields[] =
+		{
+			HAZEL_FIELD(Rigidbody2D, "Type", int, FieldFlags_None, (int)com.GetType(), com.SetType((Rigidbody2DType)value))
+				.WithEnum(TypeNames),
+			HAZEL_FIELD(Rigidbody2D, "Extents", glm::vec2, FieldFlags_None, com.GetExtents(), com.SetExtents(value))
+				.VisibleIf(HAZEL_FIELD_CONDITION(Rigidbody2D, com.GetShape() == Rigidbody2DShape::Box)),
+			HAZEL_FIELD(Rigidbody2D, "Shape", int, FieldFlags_None, (int)com.GetShape(), com.SetShape((Rigidbody2DShape)value))
+				.WithEnum(ShapeNames),
+			HAZEL_FIELD(Rigidbody2D, "Radius", float, FieldFlags_None, com.GetRadius(), com.SetRadius(value))
+				.WithRange(0.01f, 100.0f)
+				.VisibleIf(HAZEL_FIELD_CONDITION(Rigidbody2D, com.GetShape() == Rigidbody2DShape::Circle)),
+			HAZEL_FIELD(Rigidbody2D, "Vertices", std::vector<glm::vec2>, FieldFlags_None,
+				(std::vector<glm::vec2>(com.GetVertices(), com.GetVertices() + com.GetVertexCount())),
+				(com.SetVertices(value.data(), (uint32_t)value.size())))
+				.VisibleIf(HAZEL_FIELD_CONDITION(Rigidbody2D, com.GetShape() == Rigidbody2DShape::Polygon || com.GetShape() == Rigidbody2DShape::Line)),
+			HAZEL_FIELD(Rigidbody2D, "Density", float, FieldFlags_None, com.GetDensity(), (com.SetMaterial(value, com.GetFriction(), com.GetRestitution())))
+				.WithRange(0.0f, 100.0f),
+			HAZEL_FIELD(Rigidbody2D, "Friction", float, FieldFlags_None, com.GetFriction(), (com.SetMaterial(com.GetDensity(), value, com.GetRestitution())))
+				.WithRange(0.0f, 1.0f),
+			HAZEL_FIELD(Rigidbody2D, "Restitution", float, FieldFlags_None, com.GetRestitution(), (com.SetMaterial(com.GetDensity(), com.GetFriction(), value)))
+				.WithRange(0.0f, 1.0f),
+			HAZEL_FIELD(Rigidbody2D, "FixedRotation", bool, FieldFlags_None, com.IsFixedRotation(), com.SetFixedRotation(value)),
+		};
+	};
+
+#undef HAZEL_FIELD_CONDITION
+#undef HAZEL_MEMBER_FIELD
+#undef HAZEL_FIELD
+
+	// 枚举字段的值必须在EnumNames的范围内, 其余字段总是合法的
+	// YAML和二进制格式加载时都用它检查, 不合法的值不能交给Set, 否则强转出来的枚举会在之后越界访问
+	inline bool IsValidFieldValue(const FieldInfo& field, const void* value)
+	{
+		if (field.EnumCount == 0)
+			return true;
+
+		int v;
+		memcpy(&v, value, sizeof(v));
+		return v >= 0 && (uint32_t)v < field.EnumCount;
+	}
+
+	// 检查一个已经构造好的Component里所有的枚举字段, 给直接memcpy加载、不经过Set的数据用
+	template<class T>
+	bool ValidateFields(const T& com)
+	{
+		for (const FieldInfo& field : ComponentReflection<T>::Fields)
+		{
+			if (field.EnumCount == 0)
+				continue;
+
+			int value;
+			field.Get(&com, &value);
+			if (!IsValidFieldValue(field, &value))
+				return false;
+		}
+		return true;
+	}
+
+	// 按名字在字段表里查找, 没有时返回nullptr
+	template<class T>
+	const FieldInfo* FindField(const char* name)
+	{
+		for (const FieldInfo& field : ComponentReflection<T>::Fields)
+		{
+			if (strcmp(field.Name, name) == 0)
+				return &field;
+		}
+		return nullptr;
+	}
+
+	// 所有字段打包以后一个Component占的字节数, 编译期求值
+	template<class T>
+	constexpr uint32_t GetPackedSize()
+	{
+		uint32_t size = 0;
+		for (const FieldInfo& field : ComponentReflection<T>::Fields)
+			size += GetPackedFieldSize(field.Type);
+		return size;
+	}
+
+	template<class T>
+	constexpr bool IsPackable()
+	{
+		for (const FieldInfo& field : ComponentReflection<T>::Fields)
+		{
+			if (GetPackedFieldSize(field.Type) == 0)
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "ComponentTraits.h"
+#include "IDComponent.h"
+#include "NameComponent.h"
+#include "Transform.h"
+#include "SpriteRenderer.h"
+#include "CameraComponent.h"
+#include "Rigidbody2D.h"
+
+namespace Hazel
+{
+	//						Component			Serializable	EditorVisible	TriviallyRelocatable
+	HAZEL_REGISTER_COMPONENT(IDComponent,		true,			false,			true)
+	HAZEL_REGISTER_COMPONENT(NameComponent,		true,			false,			false)
+	HAZEL_REGISTER_COMPONENT(Transform,			true,			true,			true)
+	HAZEL_REGISTER_COMPONENT(SpriteRenderer,	true,			true,			false)// 持有Texture的shared_ptr
+	HAZEL_REGISTER_COMPONENT(CameraComponent,	true,			true,			true)
+	HAZEL_REGISTER_COMPONENT(Rigidbody2D,		true,			true,			true)// b2Body*只是个句柄, 搬运不影响Box2D
+
+	// 所有注册过的Component, 需要按类型遍历所有pool时使用(比如拷贝Scene)
+	using AllComponentTypes = ComponentTypeList<IDComponent, NameComponent, Transform, SpriteRenderer, CameraComponent, Rigidbody2D>;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <type_traits>
+
+namespace Hazel
+{
+	// 每个Component类型在编译期的属性, 没有注册过的类型Registered为false
+	template<class T>
+	struct ComponentTraits
+	{
+		static constexpr bool Registered = false;
+		static constexpr bool Serializable = false;			// 是否写入场景文件
+		static constexpr bool EditorVisible = false;		// 是否在Inspector里显示
+		static constexpr bool TriviallyRelocatable = false;	// pool是否可以直接memcpy来搬运和拷贝
+		static constexpr const char* Name = "";
+	};
+
+	template<class... T>
+	struct ComponentTypeList
+	{
+		static constexpr size_t Count = sizeof...(T);
+	};
+
+	// T在类型列表里的下标, 编译期求值
+	template<class T, class List>
+	struct ComponentIndex;
+
+	template<class T, class... Rest>
+	struct ComponentIndex<T, ComponentTypeList<T, Rest...>> : std::integral_constant<size_t, 0> {};
+
+	template<class T, class U, class... Rest>
+	struct ComponentIndex<T, ComponentTypeList<U, Rest...>>
+		: std::integral_constant<size_t, 1 + ComponentIndex<T, ComponentTypeList<Rest...>>::value> {};
+
+	template<class T>
+	struct ComponentTag
+	{
+		using Type = T;
+	};
+
+	// 对类型列表里的每个Component调用一次func(ComponentTag<T>{}), 用法:
+	// ForEachComponentType(AllComponentTypes{}, [](auto tag) { using T = typename decltype(tag)::Type; ... });
+	template<class... T, class Func>
+	void ForEachComponentType(ComponentTypeList<T...>, Func&& func)
+	{
+		(func(ComponentTag<T>{}), ...);
+	}
+}
+
+// TriviallyRelocatable的Component必须是trivially copyable的, 否则memcpy以后对象状态是错的
+#define HAZEL_REGISTER_COMPONENT(Type, serializable, editorVisible, triviallyRelocatable)				\
+	template<>																						\
+	struct ComponentTraits<Type>																	\
+	{																								\
+		static constexpr bool Registered = true;													\
+		static constexpr bool Serializable = serializable;											\
+		static constexpr bool EditorVisible = editorVisible;										\
+		static constexpr bool TriviallyRelocatable = triviallyRelocatable;							\
+		static constexpr const char* Name = #Type;													\
+	};																								\
+	static_assert(std::is_base_of<Component, Type>::value, #Type " must derive from Component");	\
+	static_assert(!std::is_polymorphic<Type>::value, #Type " must not have virtual functions");		\
+	static_assert(!(triviallyRelocatable) || std::is_trivially_copyable<Type>::value,				\
+		#Type " is registered as trivially relocatable but is not trivially copyable");
@@ -0,0 +1,16 @@
+#pragma once
+#include "Component.h"
+#include "../UUID.h"
+
+namespace Hazel
+{
+	// GameObject的UUID, 存到Component里而不是GameObject里, 这样GameObject只是一个很轻的句柄
+	class IDComponent : public Component
+	{
+	public:
+		IDComponent() { UUID uuid; ID = uuid; }
+		IDComponent(uint64_t id) : ID(id) {}
+
+		uint64_t ID = 0;
+	};
+}
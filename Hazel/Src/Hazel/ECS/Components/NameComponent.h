@@ -0,0 +1,15 @@
+#pragma once
+#include "Component.h"
+#include <string>
+
+namespace Hazel
+{
+	class NameComponent : public Component
+	{
+	public:
+		NameComponent() = default;
+		NameComponent(const std::string& name) : Name(name) {}
+
+		std::string Name;
+	};
+}
@@ -1,6 +1,5 @@
 #include "hzpch.h"
 #include "Rigidbody2D.h"
-#include "Physics/Physics2D.h"
 
 namespace Hazel
 {
@@ -22,81 +21,184 @@ namespace Hazel
 		}
 	}
 
-	b2PolygonShape CreateB2Shape(const Rigidbody2DShape& shape)
+	Rigidbody2D::Rigidbody2D(const float& x, const float& y, const float& angle,
+		const Rigidbody2DType& type, const Rigidbody2DShape& shape) : m_Type(type), m_Shape(shape),
+		m_Pos(x, y), m_Angle(angle), m_PrevPos(x, y), m_PrevAngle(angle)
+	{
+		// 默认的Line是x轴上长1m的线段
+		m_Vertices[0] = { -0.5f, 0.0f };
+		m_Vertices[1] = { 0.5f, 0.0f };
+		m_VertexCount = 2;
+	}
+
+	void Rigidbody2D::CreateBody(b2World* world)
+	{
+		if (world == nullptr)
+		{
+			LOG_ERROR("No World when create Rigidbody2D component");
+			return;
+		}
+
+		// b2BodyDef只在创建时使用, 不需要存在Component里
+		b2BodyDef bodyDef;
+		bodyDef.position.Set(m_Pos.x, m_Pos.y);
+		bodyDef.angle = m_Angle;
+		bodyDef.type = Rigidbody2DTypeToB2BodyType(m_Type);
+		bodyDef.fixedRotation = m_FixedRotation;
+		bodyDef.userData.pointer = (uintptr_t)m_Entity;
+		m_Body = world->CreateBody(&bodyDef);
+		m_World = world;
+		m_PrevPos = m_Pos;
+		m_PrevAngle = m_Angle;
+		m_SyncedAsleep = false;
+
+		CreateFixtures();
+	}
+
+	// 添加Fixture(即Collider), shape只是临时对象, CreateFixture会把它拷贝到b2World的内存池里
+	void Rigidbody2D::CreateFixtures()
 	{
-		switch (shape)
+		b2FixtureDef fixtureDef;
+		fixtureDef.density = m_Density;
+		fixtureDef.friction = m_Friction;
+		fixtureDef.restitution = m_Restitution;
+
+		switch (m_Shape)
 		{
-		case Rigidbody2DShape::Box:
+		case Rigidbody2DShape::Circle:
 		{
-			// TODO: 这里是否会有问题?
-			b2PolygonShape dynamicBox;
-			dynamicBox.SetAsBox(0.5f, 0.5f);// 对应1m*1m的Box
-			return dynamicBox;
+			b2CircleShape circle;
+			circle.m_radius = m_Radius;
+			fixtureDef.shape = &circle;
+			m_Body->CreateFixture(&fixtureDef);
+			return;
 		}
-		default:
+		case Rigidbody2DShape::Polygon:
+		{
+			if (m_VertexCount >= 3)
+			{
+				b2Vec2 points[MaxPolygonVertices];
+				for (uint32_t i = 0; i < m_VertexCount; i++)
+					points[i].Set(m_Vertices[i].x, m_Vertices[i].y);
+
+				// Set会计算凸包, 顶点退化(比如共线)时返回false
+				b2PolygonShape polygon;
+				if (polygon.Set(points, (int32)m_VertexCount))
+				{
+					fixtureDef.shape = &polygon;
+					m_Body->CreateFixture(&fixtureDef);
+					return;
+				}
+			}
+
+			LOG_ERROR("Invalid polygon for Rigidbody2D, use box instead");
+			break;
+		}
+		case Rigidbody2DShape::Line:
 		{
-			b2PolygonShape dynamicBox;
-			return dynamicBox;
+			if (m_VertexCount >= 2)
+			{
+				b2EdgeShape edge;
+				edge.SetTwoSided(b2Vec2(m_Vertices[0].x, m_Vertices[0].y), b2Vec2(m_Vertices[1].x, m_Vertices[1].y));
+				fixtureDef.shape = &edge;
+				m_Body->CreateFixture(&fixtureDef);
+				return;
+			}
+
+			LOG_ERROR("Invalid line for Rigidbody2D, use box instead");
+			break;
 		}
+		default:
+			break;
 		}
+
+		b2PolygonShape box;
+		box.SetAsBox(m_Extents.x, m_Extents.y);
+		fixtureDef.shape = &box;
+		m_Body->CreateFixture(&fixtureDef);
 	}
 
-	Rigidbody2D::Rigidbody2D(const float& x, const float& y, const float& angle,
-		const Rigidbody2DType& type, const Rigidbody2DShape& shape) : m_Pos(x, y), m_Angle(angle), m_Type(type), m_Shape(shape)
+	void Rigidbody2D::RebuildFixtures()
 	{
-		// TODO: 准确的说, 这部分内容不应该在AddComponent时调用, 而应该在PlayMode下调用
-		Init();
+		if (!m_Body)
+			return;
+
+		b2Fixture* fixture = m_Body->GetFixtureList();
+		while (fixture)
+		{
+			b2Fixture* next = fixture->GetNext();
+			m_Body->DestroyFixture(fixture);
+			fixture = next;
+		}
+
+		CreateFixtures();
 	}
 
-	void Rigidbody2D::Init()
+	void Rigidbody2D::DestroyBody()
 	{
-		const std::shared_ptr<b2World>& world = Physics2D::GetWorld();
+		if (m_Body && m_World)
+			m_World->DestroyBody(m_Body);
 
-		if (world == nullptr)
+		ReleaseBody();
+	}
+
+	void Rigidbody2D::ReleaseBody()
+	{
+		m_Body = nullptr;
+		m_World = nullptr;
+	}
+
+	void Rigidbody2D::DetachBody()
+	{
+		if (m_Body)
 		{
-			LOG_ERROR("No World when create Rigidbody2D component");
-			return;
+			m_Pos = { m_Body->GetPosition().x, m_Body->GetPosition().y };
+			m_Angle = m_Body->GetAngle();
 		}
 
-		// 注意, 调用CreateBody之前要把b2BodyDef里的参数都填好
-		m_BodyDef.position.Set(m_Pos.x, m_Pos.y);
-		m_BodyDef.angle = m_Angle;
-		m_BodyDef.type = Rigidbody2DTypeToB2BodyType(m_Type);
-		m_Body = world->CreateBody(&m_BodyDef);
+		ReleaseBody();
+	}
 
+	void Rigidbody2D::SetPose(const glm::vec2& pos, float angle)
+	{
+		m_Pos = m_PrevPos = pos;
+		m_Angle = m_PrevAngle = angle;
 
-		// 添加Fixture(即Collider)
-		b2FixtureDef fixtureDef;
-		b2PolygonShape dynamicBox = CreateB2Shape(m_Shape);
-		m_Extents = { 0.5f, 0.5f };
-		fixtureDef.shape = &dynamicBox;
-		fixtureDef.density = 1.0f;
-		fixtureDef.friction = 0.3f;
-		m_Body->CreateFixture(&fixtureDef);
+		if (m_Body)
+			m_Body->SetTransform(b2Vec2(pos.x, pos.y), angle);
 	}
 
-	glm::vec2 Rigidbody2D::GetLocation()
+	void Rigidbody2D::SetEntity(entt::entity entity)
 	{
+		m_Entity = entity;
 		if (m_Body)
-			return glm::vec2(m_Body->GetPosition().x, m_Body->GetPosition().y);
+			m_Body->GetUserData().pointer = (uintptr_t)entity;
+	}
 
-		return { 0,0 };
+	void Rigidbody2D::SavePreviousState()
+	{
+		m_PrevPos = GetLocation();
+		m_PrevAngle = GetAngle();
 	}
-	
-	void Rigidbody2D::SetExtents(const glm::vec2& extents)
+
+	glm::vec2 Rigidbody2D::GetInterpolatedLocation(float alpha)
 	{
-		m_Extents = extents;
+		return glm::mix(m_PrevPos, GetLocation(), alpha);
+	}
 
-		if (m_Body)
-		{
-			b2PolygonShape* p = dynamic_cast<b2PolygonShape*>(m_Body->GetFixtureList()[0].GetShape());
-			if (p)
-				p->SetAsBox(m_Extents.x, m_Extents.y);
-			else
-				LOG_ERROR("The rigidbody2D component doesn't have b2PolygonShape");
-		}
+	float Rigidbody2D::GetInterpolatedAngle(float alpha)
+	{
+		// b2Body的角度是连续累加的, 不会在2π处跳变, 直接线性插值即可
+		return glm::mix(m_PrevAngle, GetAngle(), alpha);
 	}
 
+	glm::vec2 Rigidbody2D::GetLocation()
+	{
+		if (m_Body)
+			return glm::vec2(m_Body->GetPosition().x, m_Body->GetPosition().y);
+
+		return m_Pos;
+	}
 
 	float Rigidbody2D::GetAngle()
 	{
@@ -113,4 +215,47 @@ namespace Hazel
 		if (m_Body)
 			m_Body->SetType(Rigidbody2DTypeToB2BodyType(type));
 	}
-}
\ No newline at end of file
+
+	void Rigidbody2D::SetShape(const Rigidbody2DShape& shape)
+	{
+		m_Shape = shape;
+		RebuildFixtures();
+	}
+
+	void Rigidbody2D::SetExtents(const glm::vec2& extents)
+	{
+		m_Extents = extents;
+		RebuildFixtures();
+	}
+
+	void Rigidbody2D::SetRadius(float radius)
+	{
+		m_Radius = radius;
+		RebuildFixtures();
+	}
+
+	void Rigidbody2D::SetVertices(const glm::vec2* vertices, uint32_t count)
+	{
+		m_VertexCount = std::min<uint32_t>(count, MaxPolygonVertices);
+		for (uint32_t i = 0; i < m_VertexCount; i++)
+			m_Vertices[i] = vertices[i];
+
+		RebuildFixtures();
+	}
+
+	void Rigidbody2D::SetMaterial(float density, float friction, float restitution)
+	{
+		m_Density = density;
+		m_Friction = friction;
+		m_Restitution = restitution;
+		RebuildFixtures();
+	}
+
+	void Rigidbody2D::SetFixedRotation(bool fixedRotation)
+	{
+		m_FixedRotation = fixedRotation;
+
+		if (m_Body)
+			m_Body->SetFixedRotation(fixedRotation);
+	}
+}
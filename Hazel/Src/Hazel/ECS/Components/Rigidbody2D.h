@@ -1,6 +1,7 @@
 #pragma once
 #include "Component.h"
 #include "box2d/box2d.h"
+#include "entt.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace Hazel
@@ -30,32 +31,97 @@ namespace Hazel
 	};
 
 
+	// Rigidbody2D只保存刚体和碰撞体的描述数据, 加到GameObject上、加载Scene时都不会碰Box2D
+	// b2Body由Scene在开始Play时统一批量创建(Scene::StartPhysics), Stop时整个物理世界一起销毁
 	class Rigidbody2D : public Component
 	{
 	public:
-		Rigidbody2D(const float& x, const float& y, const float& angle,
+		static constexpr uint32_t MaxPolygonVertices = b2_maxPolygonVertices;
+
+		Rigidbody2D(const float& x = 0.0f, const float& y = 0.0f, const float& angle = 0.0f,
 			const Rigidbody2DType& type = Rigidbody2DType::Dynamic, const Rigidbody2DShape& shape = Rigidbody2DShape::Box);
 
+		// 有b2Body时返回模拟的结果, 否则返回创建b2Body时使用的位置和角度
 		glm::vec2 GetLocation();
-		glm::vec2& GetExtents() { return m_Extents; }
-		void SetExtents(const glm::vec2&);
 		float GetAngle();
 
-		Rigidbody2DType GetType() { return m_Type; }
+		Rigidbody2DType GetType() const { return m_Type; }
 		void SetType(const Rigidbody2DType&);
 
-	protected:
-		void Init();
+		// 修改碰撞体的参数, 如果b2Body已经存在, 会重建它的Fixture
+		Rigidbody2DShape GetShape() const { return m_Shape; }
+		void SetShape(const Rigidbody2DShape& shape);
+		glm::vec2& GetExtents() { return m_Extents; }// Box的半边长
+		const glm::vec2& GetExtents() const { return m_Extents; }
+		void SetExtents(const glm::vec2&);
+		float GetRadius() const { return m_Radius; }// Circle的半径
+		void SetRadius(float radius);
+		// Polygon是凸多边形, 最多MaxPolygonVertices个顶点; Line是两个顶点之间的线段, 都在局部空间里
+		const glm::vec2* GetVertices() const { return m_Vertices; }
+		uint32_t GetVertexCount() const { return m_VertexCount; }
+		void SetVertices(const glm::vec2* vertices, uint32_t count);
+
+		float GetDensity() const { return m_Density; }
+		float GetFriction() const { return m_Friction; }
+		float GetRestitution() const { return m_Restitution; }
+		void SetMaterial(float density, float friction, float restitution);
+		bool IsFixedRotation() const { return m_FixedRotation; }
+		void SetFixedRotation(bool fixedRotation);
+
+		// 设置创建b2Body时使用的位置和角度, 已经有b2Body时直接移动它
+		void SetPose(const glm::vec2& pos, float angle);
+
+		// 在world里根据描述数据创建b2Body和Fixture, 由Scene调用
+		void CreateBody(b2World* world);
+		// 从创建它的b2World里删除b2Body
+		void DestroyBody();
+		// 只放弃对b2Body的引用, 不删除它, 用于整个物理世界一起销毁的情况
+		void ReleaseBody();
+
+		// 把b2Body当前的位置和角度记到m_Pos、m_Angle里, 然后放弃对b2Body的引用(不会删除它), 用于Scene::Snapshot
+		void DetachBody();
+
+		// Rigidbody2D所属的entity, 会同时记到b2Body的UserData里, 用于从b2World的body列表直接找回entity
+		void SetEntity(entt::entity entity);
+		entt::entity GetEntity() const { return m_Entity; }
+		b2Body* GetBody() const { return m_Body; }
 
+		// 上一次同步Transform时b2Body是否已经在睡眠, 睡眠期间b2Body不会移动, 不需要重复同步
+		bool IsSyncedAsleep() const { return m_SyncedAsleep; }
+		void SetSyncedAsleep(bool asleep) { m_SyncedAsleep = asleep; }
+
+		// 在一帧的最后一次物理模拟之前调用, 记下b2Body当前的状态, 渲染时在它和模拟后的状态之间插值
+		void SavePreviousState();
+		glm::vec2 GetInterpolatedLocation(float alpha);
+		float GetInterpolatedAngle(float alpha);
+
+	private:
+		void CreateFixtures();
+		void RebuildFixtures();
 
 	private:
-		b2BodyDef m_BodyDef;
+		// 描述数据
 		Rigidbody2DType m_Type;
 		Rigidbody2DShape m_Shape;
-		b2Body* m_Body = nullptr;
+		glm::vec2 m_Extents = { 0.5f, 0.5f };
+		float m_Radius = 0.5f;
+		glm::vec2 m_Vertices[MaxPolygonVertices];
+		uint32_t m_VertexCount = 0;
+		float m_Density = 1.0f;
+		float m_Friction = 0.3f;
+		float m_Restitution = 0.0f;
+		bool m_FixedRotation = false;
 
 		glm::vec2 m_Pos;
-		glm::vec2 m_Extents;
 		float m_Angle = 0.0f;
+
+		// 运行时数据, 只在Play期间有效
+		b2Body* m_Body = nullptr;
+		b2World* m_World = nullptr;// 创建m_Body的World, 也就是所属Scene的物理世界
+		entt::entity m_Entity = entt::null;
+		bool m_SyncedAsleep = false;
+
+		glm::vec2 m_PrevPos;
+		float m_PrevAngle = 0.0f;
 	};
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #include "hzpch.h"
 #include "Transform.h"
+#include "ECS/TransformStore.h"
 #include "glm/gtx/transform.hpp"
 #include "glm/gtx/matrix_decompose.hpp"
 #include "glm/gtx/quaternion.hpp"
@@ -8,15 +9,8 @@ namespace Hazel
 {
 	glm::mat4 Transform::GetTransformMat()
 	{
-		glm::mat4 translationM = glm::translate(Translation);
-
-		// Order: XYZ
-		glm::mat4 rotationM = glm::rotate(glm::mat4(1.0f), Rotation.z, { 0, 0, 1 }) *
-			glm::rotate(glm::mat4(1.0f), Rotation.y, { 0, 1, 0 }) *
-			glm::rotate(glm::mat4(1.0f), Rotation.x, { 1, 0, 0 });
-		glm::mat4 scaleM = glm::scale(glm::mat4(1.0f), Scale);
-
-		return translationM * rotationM * scaleM;
+		// Order: XYZ, 与TransformStore的批量计算共用同一份展开后的公式
+		return TransformStore::Compose(Translation, Rotation, Scale);
 	}
 
 	void Transform::SetTransformMat(const glm::mat4& trans)
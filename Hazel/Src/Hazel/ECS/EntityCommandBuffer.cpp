@@ -0,0 +1,71 @@
+#include "hzpch.h"
+#include "EntityCommandBuffer.h"
+#include "Scene.h"
+
+namespace Hazel
+{
+	PendingGameObject EntityCommandBuffer::CreateGameObject(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_CreateNames.push_back(name);
+		return { (uint32_t)m_CreateNames.size() - 1 };
+	}
+
+	void EntityCommandBuffer::DestroyGameObject(entt::entity entity)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Destroys.push_back(entity);
+	}
+
+	void EntityCommandBuffer::Record(Command&& command)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Commands.push_back(std::move(command));
+	}
+
+	void EntityCommandBuffer::Playback(Scene& scene)
+	{
+		if (IsEmpty())
+			return;
+
+		// 先把录制的内容拿出来, Playback过程中(比如on_destroy回调里)还可以继续录制, 留到下一次
+		std::vector<std::string> createNames;
+		std::vector<Command> commands;
+		std::vector<entt::entity> destroys;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			createNames.swap(m_CreateNames);
+			commands.swap(m_Commands);
+			destroys.swap(m_Destroys);
+		}
+
+		entt::registry& registry = scene.GetRegistry();
+
+		// 1. 批量创建, 与Scene::Instantiate一样, 每种Component整段insert
+		std::vector<entt::entity> created(createNames.size());
+		if (!created.empty())
+		{
+			registry.create(created.begin(), created.end());
+
+			std::vector<IDComponent> ids(created.size());
+			std::vector<NameComponent> names;
+			names.reserve(created.size());
+			for (std::string& name : createNames)
+				names.emplace_back(std::move(name));
+
+			registry.insert<IDComponent>(created.begin(), created.end(), ids.begin());
+			registry.insert<NameComponent>(created.begin(), created.end(), names.begin());
+			registry.insert<Transform>(created.begin(), created.end());
+
+			scene.AddToHierarchy(created);
+		}
+
+		// 2. Add/Remove按录制顺序执行
+		for (Command& command : commands)
+			command(registry, created);
+
+		// 3. 批量销毁
+		if (!destroys.empty())
+			scene.DestroyGameObjects(destroys);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "entt.hpp"
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Hazel
+{
+	class Scene;
+
+	// 还没有真正创建的GameObject, 只在录制它的EntityCommandBuffer里有效
+	struct PendingGameObject
+	{
+		uint32_t Index;
+	};
+
+	// System在并行执行时不能直接增删GameObject和Component(会改变pool的布局), 这类结构性修改先录制到这里,
+	// 等所有System执行完以后, 由Scene在同步点统一Playback:
+	// 1. 所有Create一次性批量创建  2. 按录制顺序执行Add/Remove  3. 所有Destroy排序去重后批量销毁
+	// 录制接口是线程安全的, 可以在多个System里同时调用
+	class EntityCommandBuffer
+	{
+	public:
+		PendingGameObject CreateGameObject(const std::string& name = "Default Name");
+		void DestroyGameObject(entt::entity entity);
+
+		template<class T, class... Args>
+		void AddComponent(entt::entity entity, Args&&... args)
+		{
+			Record([entity, com = T(std::forward<Args>(args)...)](entt::registry& registry, const std::vector<entt::entity>&) mutable
+			{
+				if (registry.valid(entity))
+					registry.emplace_or_replace<T>(entity, std::move(com));
+			});
+		}
+
+		template<class T, class... Args>
+		void AddComponent(PendingGameObject pending, Args&&... args)
+		{
+			Record([pending, com = T(std::forward<Args>(args)...)](entt::registry& registry, const std::vector<entt::entity>& created) mutable
+			{
+				registry.emplace_or_replace<T>(created[pending.Index], std::move(com));
+			});
+		}
+
+		template<class T>
+		void RemoveComponent(entt::entity entity)
+		{
+			Record([entity](entt::registry& registry, const std::vector<entt::entity>&)
+			{
+				if (registry.valid(entity))
+					registry.remove<T>(entity);
+			});
+		}
+
+		// 只能在主线程, 且没有System在执行时调用
+		void Playback(Scene& scene);
+
+		bool IsEmpty() const { return m_CreateNames.empty() && m_Commands.empty() && m_Destroys.empty(); }
+
+	private:
+		using Command = std::function<void(entt::registry&, const std::vector<entt::entity>&)>;
+		void Record(Command&& command);
+
+	private:
+		std::mutex m_Mutex;
+		std::vector<std::string> m_CreateNames;
+		std::vector<Command> m_Commands;
+		std::vector<entt::entity> m_Destroys;
+	};
+}
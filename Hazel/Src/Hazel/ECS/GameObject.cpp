@@ -8,26 +8,68 @@
 
 namespace Hazel
 {
-	GameObject::GameObject(const std::shared_ptr<Scene>& ps, const entt::entity & entity, const std::string& name)
-		: m_Scene(ps), m_InsanceId(entity), m_Name(name)
+	static_assert(sizeof(GameObject) == 8, "GameObject should stay a lightweight handle");
+	static_assert(std::is_trivially_copyable<GameObject>::value, "GameObject should stay trivially copyable");
+
+	GameObject::SceneSlot GameObject::s_SceneSlots[GameObject::MaxScenes];
+	static std::mutex s_SceneTableMutex;
+
+	uint32_t GameObject::RegisterScene(Scene* scene, entt::registry* registry)
 	{
-		m_ID = std::make_shared<UUID>();
+		std::lock_guard<std::mutex> lock(s_SceneTableMutex);
+		for (uint32_t i = 0; i < MaxScenes; i++)
+		{
+			SceneSlot& slot = s_SceneSlots[i];
+			if (!slot.Owner.load(std::memory_order_relaxed))
+			{
+				slot.Owner.store(scene, std::memory_order_release);
+				slot.Registry.store(registry, std::memory_order_release);
+				return (slot.Generation.load(std::memory_order_relaxed) << SceneSlotBits) | i;
+			}
+		}
+
+		HAZEL_ASSERT(false, "Too Many Scenes Alive At The Same Time!");
+		return InvalidSceneIndex;
 	}
 
-	GameObject::GameObject(const std::shared_ptr<Scene>& ps, const entt::entity& entity, const uint64_t& id, const std::string& name)
-		: m_Scene(ps), m_InsanceId(entity), m_Name(name)
+	void GameObject::UnregisterScene(uint32_t sceneIndex)
 	{
-		m_ID = std::make_shared<UUID>();
-		m_ID->SetId(id);
+		if (sceneIndex == InvalidSceneIndex)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_SceneTableMutex);
+		SceneSlot& slot = s_SceneSlots[sceneIndex & (MaxScenes - 1)];
+		slot.Registry.store(nullptr, std::memory_order_release);
+		slot.Owner.store(nullptr, std::memory_order_release);
+
+		// generation全为1时与槽位1023拼出来的句柄就是InvalidSceneIndex, 跳过这个值
+		uint32_t generation = (slot.Generation.load(std::memory_order_relaxed) + 1) & SceneGenerationMask;
+		if (generation == SceneGenerationMask)
+			generation = 0;
+		slot.Generation.store(generation, std::memory_order_release);
 	}
 
-	glm::vec3 GameObject::GetPosition()
+	entt::registry* GameObject::FindRegistry() const
 	{
-		HAZEL_ASSERT(HasComponent<Transform>(), "GameObject Missing TransformComponent");
-		return GetComponent<Transform>().Translation;
+		if (m_SceneIndex == InvalidSceneIndex)
+			return nullptr;
+
+		const SceneSlot& slot = s_SceneSlots[m_SceneIndex & (MaxScenes - 1)];
+		entt::registry* registry = slot.Registry.load(std::memory_order_acquire);
+		return slot.Generation.load(std::memory_order_acquire) == (m_SceneIndex >> SceneSlotBits) ? registry : nullptr;
+	}
+
+	Scene* GameObject::GetScene() const
+	{
+		if (m_SceneIndex == InvalidSceneIndex)
+			return nullptr;
+
+		const SceneSlot& slot = s_SceneSlots[m_SceneIndex & (MaxScenes - 1)];
+		Scene* scene = slot.Owner.load(std::memory_order_acquire);
+		return slot.Generation.load(std::memory_order_acquire) == (m_SceneIndex >> SceneSlotBits) ? scene : nullptr;
 	}
 
-	glm::vec3 GameObject::GetRotation()
+	glm::vec3 GameObject::GetRotation() const
 	{
 		HAZEL_ASSERT(HasComponent<Transform>(), "GameObject Missing TransformComponent");
 		return GetComponent<Transform>().Rotation;
@@ -43,23 +85,25 @@ namespace Hazel
 	{
 		HAZEL_ASSERT(HasComponent<Transform>(), "GameObject Missing TransformComponent");
 		GetComponent<Transform>().Translation = p;
+		GetScene()->MarkDirty<Transform>(m_InsanceId);
 	}
 
-	glm::mat4 GameObject::GetTransformMat()
+	glm::mat4 GameObject::GetTransformMat() const
 	{
 		HAZEL_ASSERT(HasComponent<Transform>(), "GameObject Missing TransformComponent");
 		return GetComponent<Transform>().GetTransformMat();
 	}
 
-	glm::mat4 GameObject::GetTransformMat() const
+	void GameObject::SetTransformMat(const glm::mat4& trans)
 	{
 		HAZEL_ASSERT(HasComponent<Transform>(), "GameObject Missing TransformComponent");
-		return GetComponent<Transform>().GetTransformMat();
+		GetComponent<Transform>().SetTransformMat(trans);
+		GetScene()->MarkDirty<Transform>(m_InsanceId);
 	}
 
-	void GameObject::SetTransformMat(const glm::mat4& trans)
+	void GameObject::SetName(const std::string& name)
 	{
-		HAZEL_ASSERT(HasComponent<Transform>(), "GameObject Missing TransformComponent");
-		return GetComponent<Transform>().SetTransformMat(trans);
+		GetComponent<NameComponent>().Name = name;
+		GetScene()->MarkDirty<NameComponent>(m_InsanceId);
 	}
 }
\ No newline at end of file
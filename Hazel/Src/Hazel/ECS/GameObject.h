@@ -2,95 +2,108 @@
 #include "entt.hpp"
 #include "Scene.h"
 #include "UUID.h"
+#include "Components/ComponentRegistry.h"
+#include <atomic>
 
 namespace Hazel
 {
 	class Scene;
+
+	// GameObject只是一个8字节的句柄: entity加上Scene的句柄, 可以随意按值拷贝
+	// Scene的句柄低位是Scene表里的槽位, 高位是这个槽位的generation, Scene销毁后槽位被复用时,
+	// 旧的GameObject因为generation对不上而失效, 不会解析到新的Scene里
+	// 名字和UUID分别存在NameComponent和IDComponent里, 访问Component时也不再需要weak_ptr::lock()
 	class GameObject
 	{
+		friend class Scene;
 	public:
+		// SimulationRunner会同时运行几百个Scene, 表本身只是几个指针, 开大一些也没有什么开销
+		static constexpr uint32_t SceneSlotBits = 10;
+		static constexpr uint32_t MaxScenes = 1u << SceneSlotBits;
+		static constexpr uint32_t SceneGenerationMask = (1u << (32 - SceneSlotBits)) - 1;
+		static constexpr uint32_t InvalidSceneIndex = 0xFFFFFFFF;
+
 		GameObject() = default;
-		GameObject(const std::shared_ptr<Scene>& ps, const entt::entity& entity, const std::string& name = "Default GameObject");
-		GameObject(const std::shared_ptr<Scene>& ps, const entt::entity& entity, const uint64_t& id, const std::string& name = "Default GameObject");
+		GameObject(entt::entity entity, uint32_t sceneIndex) : m_InsanceId(entity), m_SceneIndex(sceneIndex) {}
 
 		template<class T, class... Args>
 		T& AddComponent(Args&& ...args)
 		{
-			std::shared_ptr<Scene> p = m_Scene.lock();
-
-			// Hazel这里存了Scene的Raw Pointer
-			auto& com = p->GetRegistry().emplace<T>(m_InsanceId, std::forward<Args>(args)...);
-			com.InstanceId = (uint32_t)m_InsanceId;
-			return com;
-		}
-
-		template<class T>
-		bool HasComponent()
-		{
-			std::shared_ptr<Scene> p = m_Scene.lock();
-
-			if (p)
-				return p->GetRegistry().all_of<T>(m_InsanceId);
-
-			return false;
+			static_assert(ComponentTraits<T>::Registered, "Component must be registered with HAZEL_REGISTER_COMPONENT");
+			return GetRegistry().emplace<T>(m_InsanceId, std::forward<Args>(args)...);
 		}
 
 		template<class T>
 		bool HasComponent() const
 		{
-			std::shared_ptr<Scene> p = m_Scene.lock();
+			if (!IsValid())
+				return false;
 
-			if (p)
-				return p->GetRegistry().all_of<T>(m_InsanceId);
-
-			return false;
+			return GetRegistry().all_of<T>(m_InsanceId);
 		}
 
 		template<class T>
-		T& GetComponent()
+		T& GetComponent() const
 		{
 			HAZEL_ASSERT(HasComponent<T>(), "GameObject Does Not Have The Specified Component!")
 
-				std::shared_ptr<Scene> p = m_Scene.lock();
-
-			return p->GetRegistry().get<T>(m_InsanceId);
+			return GetRegistry().get<T>(m_InsanceId);
 		}
 
-		template<class T>
-		T& GetComponent() const
+		bool IsValid() const
 		{
-			HAZEL_ASSERT(HasComponent<T>(), "GameObject Does Not Have The Specified Component!")
-
-				std::shared_ptr<Scene> p = m_Scene.lock();
-
-			return p->GetRegistry().get<T>(m_InsanceId);
+			entt::registry* registry = FindRegistry();
+			return registry && registry->valid(m_InsanceId);
 		}
 
+		// Scene已经销毁时返回nullptr
+		Scene* GetScene() const;
 
-		operator entt::entity() { return m_InsanceId; }
 		operator entt::entity() const { return m_InsanceId; }
 
-		void SetName(const std::string& name) { m_Name = name; }
-		const std::string& ToString() CONST { return m_Name; }
-		//std::string& ToString() { return m_Name; }
+		void SetName(const std::string& name);
+		const std::string& ToString() const { return GetComponent<NameComponent>().Name; }
 		const uint32_t GetInstanceId() const { return (uint32_t)m_InsanceId; }
-		const uint64_t GetUUID() const { return (*m_ID); }
+		const uint64_t GetUUID() const { return GetComponent<IDComponent>().ID; }
 
 
-		glm::vec3 GetPosition();
 		glm::vec3 GetPosition() const;
-		glm::vec3 GetRotation();
+		glm::vec3 GetRotation() const;
 		
 		void SetPosition(const glm::vec3& p);
 
-		glm::mat4 GetTransformMat();
 		glm::mat4 GetTransformMat() const;
 
 		void SetTransformMat(const glm::mat4& trans);
+
 	private:
-		entt::entity m_InsanceId;
-		std::weak_ptr<Scene> m_Scene;
-		std::string m_Name;
-		std::shared_ptr<UUID> m_ID;
+		entt::registry& GetRegistry() const
+		{
+			entt::registry* registry = FindRegistry();
+			HAZEL_ASSERT(registry, "GameObject Belongs To A Destroyed Scene!");
+			return *registry;
+		}
+
+		// 槽位里的generation与句柄一致时返回对应的registry, 否则返回nullptr
+		entt::registry* FindRegistry() const;
+
+		// 由Scene在构造和析构时登记、注销, 返回带generation的Scene句柄
+		static uint32_t RegisterScene(Scene* scene, entt::registry* registry);
+		static void UnregisterScene(uint32_t sceneIndex);
+
+	private:
+		entt::entity m_InsanceId = entt::null;
+		uint32_t m_SceneIndex = InvalidSceneIndex;
+
+		// Scene的数量很少, 用固定大小的数组; 登记和注销时加锁, 查找时只读原子变量, 不需要加锁
+		// 注销时先清空指针再增加generation, 读取时先读指针再核对generation, 读到的指针一定属于句柄对应的Scene
+		struct SceneSlot
+		{
+			std::atomic<Scene*> Owner = nullptr;
+			std::atomic<entt::registry*> Registry = nullptr;
+			std::atomic<uint32_t> Generation = 0;
+		};
+
+		static SceneSlot s_SceneSlots[MaxScenes];
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,177 @@
+#include "hzpch.h"
+#include "IncrementalSceneSaver.h"
+#include "SceneSerializer.h"
+#include "Scene.h"
+
+namespace Hazel
+{
+	IncrementalSceneSaver::~IncrementalSceneSaver()
+	{
+		WaitForCompaction();
+	}
+
+	void IncrementalSceneSaver::Reset()
+	{
+		WaitForCompaction();
+		m_Scene = nullptr;
+		m_Path.clear();
+		m_Texts.clear();
+	}
+
+	void IncrementalSceneSaver::Save(const std::shared_ptr<Scene>& scene, const std::string& path)
+	{
+		if (m_Compacting && m_CompactionCounter.IsDone())
+			FinishCompaction();
+
+		if (scene.get() != m_Scene || path != m_Path)
+		{
+			SaveFull(scene, path);
+			return;
+		}
+
+		std::vector<entt::entity> dirty;
+		std::vector<uint64_t> removed;
+		scene->ConsumeDirtyGameObjects(dirty, removed);
+		if (dirty.empty() && removed.empty())
+			return;
+
+		// 先删除再写入, 与SceneSerializer::ApplyDelta的顺序一致
+		for (uint64_t uuid : removed)
+			m_Texts.erase(uuid);
+
+		std::string delta = "---\nGeneration: " + std::to_string(++m_Generation) + "\n";
+		delta += dirty.empty() ? "GameObjects: []\n" : "GameObjects:\n";
+		for (entt::entity entity : dirty)
+		{
+			GameObject go(entity, scene->GetSceneIndex());
+			std::shared_ptr<std::string> text = std::make_shared<std::string>();
+			SceneSerializer::EmitGameObject(go, *text);
+			delta += *text;
+			m_Texts[go.GetUUID()] = text;
+		}
+
+		delta += "Removed: [";
+		for (size_t i = 0; i < removed.size(); i++)
+			delta += (i ? ", " : "") + std::to_string(removed[i]);
+		delta += "]\n";
+
+		std::ofstream fout(SceneSerializer::GetDeltaPath(path), std::ios::app);
+		fout << delta;
+
+		m_DeltaCount += (uint32_t)(dirty.size() + removed.size());
+		if (m_Compacting)
+		{
+			m_DeltasSinceCompaction.push_back(std::move(delta));
+			m_DeltaCountSinceCompaction += (uint32_t)(dirty.size() + removed.size());
+		}
+		else if (m_DeltaCount >= m_CompactionThreshold)
+			StartCompaction(scene);
+	}
+
+	void IncrementalSceneSaver::SaveFull(const std::shared_ptr<Scene>& scene, const std::string& path)
+	{
+		WaitForCompaction();
+
+		// 完整写出的内容就是当前的状态, 之前记录的脏标记都不需要了
+		std::vector<entt::entity> dirty;
+		std::vector<uint64_t> removed;
+		scene->ConsumeDirtyGameObjects(dirty, removed);
+
+		const std::vector<GameObject>& gos = scene->GetGameObjects();
+		std::vector<std::shared_ptr<std::string>> texts(gos.size());
+		JobSystem::ParallelFor(gos.size(), 0, [&gos, &texts](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					texts[i] = std::make_shared<std::string>();
+					SceneSerializer::EmitGameObject(gos[i], *texts[i]);
+				}
+			}, "SaveSceneFull");
+
+		m_Texts.clear();
+		m_Texts.reserve(gos.size());
+		for (size_t i = 0; i < gos.size(); i++)
+			m_Texts[gos[i].GetUUID()] = texts[i];
+
+		// 之后追加的增量都要比delta里已有的新, 基础文件替换完成以后才删除delta
+		m_Generation = std::max<uint64_t>(m_Generation, SceneSerializer::GetLatestDeltaGeneration(path));
+		std::string tempPath = path + ".tmp";
+		{
+			std::ofstream fout(tempPath);
+			fout << "Scene: Untitled\nGeneration: " << m_Generation << "\n";
+			fout << (gos.empty() ? "GameObjects: []\n" : "GameObjects:\n");
+			for (const std::shared_ptr<std::string>& text : texts)
+				fout << *text;
+		}
+		SceneSerializer::ReplaceBaseFile(tempPath, path);
+
+		m_Scene = scene.get();
+		m_Path = path;
+		m_DeltaCount = 0;
+	}
+
+	void IncrementalSceneSaver::StartCompaction(const std::shared_ptr<Scene>& scene)
+	{
+		// 在主线程按Hierarchy的顺序取出缓存文本的引用, 后台线程只读这份拷贝, 不会碰Scene
+		std::vector<std::shared_ptr<const std::string>> texts;
+		texts.reserve(scene->GetGameObjects().size());
+		for (const GameObject& go : scene->GetGameObjects())
+		{
+			auto it = m_Texts.find(go.GetUUID());
+			if (it != m_Texts.end())
+				texts.push_back(it->second);
+		}
+
+		m_Compacting = true;
+		m_DeltasSinceCompaction.clear();
+		m_DeltaCountSinceCompaction = 0;
+
+		std::string path = m_Path;
+		uint64_t generation = m_Generation;
+		JobSystem::Submit([texts = std::move(texts), path, generation]()
+			{
+				// 先写到临时文件再替换, 任何时候磁盘上的基础文件都是完整的
+				std::string tempPath = path + ".compact";
+				{
+					std::ofstream fout(tempPath);
+					fout << "Scene: Untitled\nGeneration: " << generation << "\n";
+					fout << (texts.empty() ? "GameObjects: []\n" : "GameObjects:\n");
+					for (const std::shared_ptr<const std::string>& text : texts)
+						fout << *text;
+				}
+
+				std::error_code ec;
+				std::filesystem::rename(tempPath, path, ec);
+			}, &m_CompactionCounter, "CompactScene");
+	}
+
+	void IncrementalSceneSaver::FinishCompaction()
+	{
+		// 基础文件已经包含了压缩开始之前的所有增量, delta文件里只留下之后追加的
+		// 同样先写临时文件再替换, 中途退出时旧的delta仍然完整, 已经合并的部分会按Generation跳过
+		std::string deltaPath = SceneSerializer::GetDeltaPath(m_Path);
+		std::string tempPath = deltaPath + ".tmp";
+		{
+			std::ofstream fout(tempPath, std::ios::trunc);
+			for (const std::string& delta : m_DeltasSinceCompaction)
+				fout << delta;
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, deltaPath, ec);
+
+		m_DeltaCount = m_DeltaCountSinceCompaction;
+		m_DeltasSinceCompaction.clear();
+		m_DeltaCountSinceCompaction = 0;
+		m_Compacting = false;
+	}
+
+	void IncrementalSceneSaver::WaitForCompaction()
+	{
+		if (!m_Compacting)
+			return;
+
+		JobSystem::Wait(m_CompactionCounter);
+		FinishCompaction();
+	}
+}
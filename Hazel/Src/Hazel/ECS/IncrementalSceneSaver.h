@@ -0,0 +1,58 @@
+#pragma once
+#include "Hazel/Core/JobSystem.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Hazel
+{
+	class Scene;
+
+	// 编辑器里反复保存同一个Scene时使用, 保存的耗时只与改动的GameObject数量有关, 与Scene的大小无关
+	// - 第一次保存(或者换了Scene、路径)时完整地写出YAML, 同时缓存每个GameObject写出的文本
+	// - 之后只把Scene记录的脏GameObject重新写出, 与被删除的UUID一起作为一个YAML文档追加到"<path>.delta"
+	// - 增量累计到一定数量以后, 用缓存的文本在后台线程里重新写出完整的基础文件, 然后清掉已经合并的增量
+	// 基础文件和每个增量都带有Generation, SceneSerializer::Load只应用比基础文件新的增量, 压缩中途退出也不会重复应用
+	class IncrementalSceneSaver
+	{
+	public:
+		IncrementalSceneSaver() = default;
+		~IncrementalSceneSaver();
+
+		IncrementalSceneSaver(const IncrementalSceneSaver&) = delete;
+		IncrementalSceneSaver& operator=(const IncrementalSceneSaver&) = delete;
+
+		void Save(const std::shared_ptr<Scene>& scene, const std::string& path);
+
+		// 重新加载了Scene以后调用, 下一次保存会完整写出
+		void Reset();
+
+		// 增量里累计的GameObject数量达到这个值时开始后台压缩
+		void SetCompactionThreshold(uint32_t count) { m_CompactionThreshold = count; }
+		bool IsCompacting() const { return m_Compacting; }
+
+	private:
+		void SaveFull(const std::shared_ptr<Scene>& scene, const std::string& path);
+		void StartCompaction(const std::shared_ptr<Scene>& scene);
+		void FinishCompaction();
+		void WaitForCompaction();
+
+	private:
+		Scene* m_Scene = nullptr;
+		std::string m_Path;
+
+		// 每个GameObject(按UUID)最近一次写出的文本, 压缩时只需要按Hierarchy的顺序拼起来
+		std::unordered_map<uint64_t, std::shared_ptr<const std::string>> m_Texts;
+
+		uint64_t m_Generation = 0;
+		uint32_t m_DeltaCount = 0;
+		uint32_t m_CompactionThreshold = 4096;
+
+		bool m_Compacting = false;
+		JobCounter m_CompactionCounter;
+		// 压缩开始以后追加的增量, 压缩完成后delta文件里只保留这些
+		std::vector<std::string> m_DeltasSinceCompaction;
+		uint32_t m_DeltaCountSinceCompaction = 0;
+	};
+}
@@ -0,0 +1,34 @@
+#include "hzpch.h"
+#include "Prefab.h"
+
+namespace Hazel
+{
+	Prefab::Prefab(const std::string& name)
+		: m_Name(name)
+	{
+		// 与CreateGameObjectInScene一致, 每个GameObject都有Transform
+		AddComponent<Transform>();
+	}
+
+	Prefab::PrototypeComponent* Prefab::Find(entt::id_type type)
+	{
+		for (PrototypeComponent& com : m_Components)
+		{
+			if (com.Type == type)
+				return &com;
+		}
+
+		return nullptr;
+	}
+
+	const Prefab::PrototypeComponent* Prefab::Find(entt::id_type type) const
+	{
+		for (const PrototypeComponent& com : m_Components)
+		{
+			if (com.Type == type)
+				return &com;
+		}
+
+		return nullptr;
+	}
+}
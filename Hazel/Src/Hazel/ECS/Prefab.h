@@ -0,0 +1,79 @@
+#pragma once
+#include "Hazel/Core/Core.h"
+#include "entt.hpp"
+#include "Components/ComponentRegistry.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Hazel
+{
+	// Prefab记录了一组Component的原型, Scene::Instantiate会把这些原型批量拷贝给新创建的GameObject
+	// 每个GameObject的IDComponent和NameComponent由Instantiate生成, 不能放在Prefab里
+	class Prefab
+	{
+		friend class Scene;
+	public:
+		Prefab(const std::string& name = "Prefab");
+
+		template<class T, class... Args>
+		T& AddComponent(Args&&... args)
+		{
+			static_assert(ComponentTraits<T>::Registered, "Component must be registered with HAZEL_REGISTER_COMPONENT");
+			static_assert(!std::is_same<T, IDComponent>::value && !std::is_same<T, NameComponent>::value,
+				"IDComponent and NameComponent are generated per instance");
+			// Rigidbody2D只是描述数据, 原型本身永远不会有b2Body, 实例化时由Scene为每个GameObject单独创建
+
+			std::shared_ptr<T> prototype = std::make_shared<T>(std::forward<Args>(args)...);
+
+			PrototypeComponent com;
+			com.Type = entt::type_hash<T>::value();
+			com.Prototype = prototype;
+			com.Insert = [](entt::registry& registry, const entt::entity* first, const entt::entity* last, const void* p)
+			{
+				registry.insert<T>(first, last, *static_cast<const T*>(p));
+			};
+
+			PrototypeComponent* existing = Find(com.Type);
+			if (existing)
+				*existing = com;
+			else
+				m_Components.push_back(com);
+
+			return *prototype;
+		}
+
+		template<class T>
+		bool HasComponent() const
+		{
+			return Find(entt::type_hash<T>::value()) != nullptr;
+		}
+
+		template<class T>
+		T& GetComponent()
+		{
+			PrototypeComponent* com = Find(entt::type_hash<T>::value());
+			HAZEL_ASSERT(com, "Prefab Does Not Have The Specified Component!");
+			return *static_cast<T*>(com->Prototype.get());
+		}
+
+		const std::string& GetName() const { return m_Name; }
+		void SetName(const std::string& name) { m_Name = name; }
+
+	private:
+		struct PrototypeComponent
+		{
+			entt::id_type Type;
+			std::shared_ptr<void> Prototype;
+			// 把原型拷贝给[first, last)里的所有entity, 内部调用registry.insert, 一次完成整个区间
+			void(*Insert)(entt::registry&, const entt::entity*, const entt::entity*, const void*);
+		};
+
+		PrototypeComponent* Find(entt::id_type type);
+		const PrototypeComponent* Find(entt::id_type type) const;
+
+	private:
+		std::string m_Name;
+		std::vector<PrototypeComponent> m_Components;
+	};
+}
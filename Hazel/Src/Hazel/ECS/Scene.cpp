@@ -4,17 +4,133 @@
 
 namespace Hazel
 {
+	// 销毁entity或者移除Rigidbody2D时, 把对应的b2Body从物理世界里删掉
+	static void OnRigidbody2DDestroy(entt::registry& registry, entt::entity entity)
+	{
+		registry.get<Rigidbody2D>(entity).DestroyBody();
+	}
+
+	// pool的拷贝: trivially relocatable的Component按page整块memcpy, 其他的逐个拷贝构造
+	template<class T>
+	static std::shared_ptr<const SceneSnapshot::ComponentPool> CapturePool(entt::registry& registry)
+	{
+		constexpr size_t pageSize = entt::component_traits<T>::page_size;
+		auto& storage = registry.storage<T>();
+		size_t cnt = storage.size();
+		T* const* pages = storage.raw();
+
+		std::shared_ptr<SceneSnapshot::ComponentPool> pool = std::make_shared<SceneSnapshot::ComponentPool>();
+		pool->Entities.assign(storage.data(), storage.data() + cnt);
+
+		std::shared_ptr<std::vector<T>> components = std::make_shared<std::vector<T>>();
+		if constexpr (ComponentTraits<T>::TriviallyRelocatable && !SnapshotPolicy<T>::HasHooks && std::is_default_constructible<T>::value)
+		{
+			components->resize(cnt);
+			for (size_t offset = 0; offset < cnt; offset += pageSize)
+				memcpy(components->data() + offset, pages[offset / pageSize], std::min<size_t>(pageSize, cnt - offset) * sizeof(T));
+		}
+		else
+		{
+			components->reserve(cnt);
+			for (size_t i = 0; i < cnt; i++)
+			{
+				components->push_back(pages[i / pageSize][i % pageSize]);
+				SnapshotPolicy<T>::OnCapture(components->back());
+			}
+		}
+
+		pool->Components = components;
+		return pool;
+	}
+
+	template<class T>
+	static void RestorePool(entt::registry& registry, const SceneSnapshot::ComponentPool& pool)
+	{
+		constexpr size_t pageSize = entt::component_traits<T>::page_size;
+		auto& storage = registry.storage<T>();
+		const std::vector<T>& components = *static_cast<const std::vector<T>*>(pool.Components.get());
+		size_t cnt = pool.Entities.size();
+
+		// pool里的entity和顺序都没变时(一般Play期间只改了数据), 直接覆盖数据, 不需要重建pool
+		bool sameLayout = storage.size() == cnt && std::equal(pool.Entities.begin(), pool.Entities.end(), storage.data());
+		if (sameLayout)
+		{
+			T* const* pages = storage.raw();
+			if constexpr (ComponentTraits<T>::TriviallyRelocatable && !SnapshotPolicy<T>::HasHooks)
+			{
+				for (size_t offset = 0; offset < cnt; offset += pageSize)
+					memcpy(pages[offset / pageSize], components.data() + offset, std::min<size_t>(pageSize, cnt - offset) * sizeof(T));
+			}
+			else
+			{
+				for (size_t i = 0; i < cnt; i++)
+				{
+					T& live = pages[i / pageSize][i % pageSize];
+					SnapshotPolicy<T>::OnRelease(live);
+					live = components[i];
+					SnapshotPolicy<T>::OnRestore(live);
+				}
+			}
+			return;
+		}
+
+		registry.clear<T>();
+		registry.insert<T>(pool.Entities.begin(), pool.Entities.end(), components.begin());
+
+		if constexpr (SnapshotPolicy<T>::HasHooks)
+		{
+			T* const* pages = storage.raw();
+			for (size_t i = 0; i < cnt; i++)
+				SnapshotPolicy<T>::OnRestore(pages[i / pageSize][i % pageSize]);
+		}
+	}
+
 	Scene::Scene()
 	{
+		m_SceneIndex = GameObject::RegisterScene(this, &m_Registry);
+
+		// owning group需要在Scene创建时就建立, 之后entt会在增删Component时维护两个pool的排列
+		(void)m_Registry.group<Transform, SpriteRenderer>();
+
+		m_Registry.on_construct<Rigidbody2D>().connect<&Scene::OnRigidbody2DConstruct>(*this);
+		m_Registry.on_destroy<Rigidbody2D>().connect<&OnRigidbody2DDestroy>();
+		m_Registry.on_destroy<Transform>().connect<&Scene::OnTransformDestroy>(*this);
+		m_Registry.on_destroy<IDComponent>().connect<&Scene::OnIDComponentDestroy>(*this);
+
+		// 增删Component时标记对应的pool, Snapshot据此判断哪些pool可以共享
+		m_PoolDirty.fill(true);
+		ForEachComponentType(AllComponentTypes{}, [this](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				m_Registry.on_construct<T>().template connect<&Scene::OnPoolChanged<T>>(*this);
+				m_Registry.on_destroy<T>().template connect<&Scene::OnPoolChanged<T>>(*this);
+				m_Registry.on_update<T>().template connect<&Scene::OnPoolChanged<T>>(*this);
+			});
+
+		// ----  Update Physics -----
+		// 物理以固定步长模拟, 与帧率无关: 一帧可能模拟0步, 也可能模拟多步
+		m_Scheduler.AddSystem("Physics2D", [](Scene& scene, float deltaTime) { scene.StepPhysics(deltaTime); })
+			.Writes<Rigidbody2D>();
+
+		// 处理碰撞的System声明Reads<Rigidbody2D>并注册在Physics2D之后, 就会在物理模拟之后执行,
+		// 在里面遍历scene.GetContactEvents(), 一次处理本帧所有的接触事件(包括上一帧Playback里删除b2Body产生的End事件)
+
+		// 根据Physics计算得到的rigidBody的结果, 插值以后反过来应用到GameObject的Transform上
+		m_Scheduler.AddSystem("TransformSync", [](Scene& scene, float deltaTime) { scene.UpdateTransformsAfterPhysicsSim(); })
+			.Reads<Rigidbody2D>()
+			.Writes<Transform>()
+			.MarksWrittenEntities();
 	}
 
 	Scene::~Scene()
 	{
 		m_Registry.clear();
+		GameObject::UnregisterScene(m_SceneIndex);
 	}
 
 	void Scene::Begin()
 	{
+		StartPhysics();
 	}
 
 	void Scene::Pause()
@@ -23,6 +139,43 @@ namespace Hazel
 
 	void Scene::Stop()
 	{
+		StopPhysics();
+	}
+
+	// 开始Play时在一个空的物理世界里一次性创建所有的b2Body, 加载Scene、编辑期间都不会碰Box2D
+	void Scene::StartPhysics()
+	{
+		if (m_PhysicsRunning)
+			return;
+
+		// 编辑模式下累加的时间不应该在Play的第一帧一次性模拟掉, ResetWorld会清空累加器
+		m_Physics.ResetWorld();
+		m_PhysicsRunning = true;
+		m_PendingBodies.clear();
+
+		b2World* world = m_Physics.GetWorld();
+		for (auto [entity, rb] : m_Registry.view<Rigidbody2D>().each())
+		{
+			// 以编辑器里的Transform为准
+			if (const Transform* t = m_Registry.try_get<Transform>(entity))
+				rb.SetPose({ t->Translation.x, t->Translation.y }, t->Rotation.z);
+
+			rb.CreateBody(world);
+		}
+	}
+
+	// 所有的b2Body随着物理世界一起销毁, 不再逐个调用DestroyBody
+	void Scene::StopPhysics()
+	{
+		if (!m_PhysicsRunning)
+			return;
+
+		for (auto [entity, rb] : m_Registry.view<Rigidbody2D>().each())
+			rb.ReleaseBody();
+
+		m_Physics.ResetWorld();
+		m_PhysicsRunning = false;
+		m_PendingBodies.clear();
 	}
 
 	void Scene::Clear()
@@ -32,13 +185,20 @@ namespace Hazel
 
 	void Scene::Update(const float& deltaTime)
 	{
+		// 两帧之间(编辑器、脚本)新加的Rigidbody2D
+		CreatePendingBodies();
 
-		// ----  Update Physics -----
-		// TODO 物理部分的更新可能得稳定一分钟固定次数
-		Physics2D::Update();
+		// 根据各个System声明的读写关系, 不冲突的System会在JobSystem里并行执行
+		m_Scheduler.Run(*this, deltaTime);
+
+		// 处理接触事件的System都执行完了, 在Playback之前清空:
+		// Playback里删除b2Body产生的End事件要留到下一帧, 和下一帧模拟产生的事件一起处理
+		m_Physics.ClearContactEvents();
 
-		// 根据Physics计算得到的rigidBody的结果, 反过来应用到GameObject的Transform上
-		UpdateTransformsAfterPhysicsSim();
+		// 同步点: 所有System都执行完了, 这时再执行录制的结构性修改
+		m_CommandBuffer.Playback(*this);
+		// Playback里先加Rigidbody2D、后设置Transform的GameObject也用最终的位置创建b2Body
+		CreatePendingBodies();
 	}
 
 	void Scene::OnViewportResized(uint32_t width, uint32_t height)
@@ -54,23 +214,63 @@ namespace Hazel
 
 	void Scene::ClearAllGameObjectsInScene()
 	{
+		m_Registry.clear();
 		m_GameObjects.clear();
+		m_SpatialIndex.Clear();
 	}
 
-	GameObject& Scene::CreateGameObjectInScene(const std::shared_ptr<Scene>& ps, const std::string& name)
+	GameObject Scene::CreateGameObjectInScene(const std::string& name)
 	{
-		GameObject go(ps, m_Registry.create(), name);
-		go.AddComponent<Transform>();
-		m_GameObjects.push_back(go);
-		return m_GameObjects[m_GameObjects.size() - 1];
+		return CreateGameObjectInSceneWithUUID(UUID(), name);
 	}
 
-	GameObject& Scene::CreateGameObjectInSceneWithUUID(const std::shared_ptr<Scene>& ps, const uint64_t& id, const std::string& name)
+	GameObject Scene::CreateGameObjectInSceneWithUUID(const uint64_t& id, const std::string& name)
 	{
-		GameObject go(ps, m_Registry.create(), id, name);
+		GameObject go(m_Registry.create(), m_SceneIndex);
+		go.AddComponent<IDComponent>(id);
+		go.AddComponent<NameComponent>(name);
 		go.AddComponent<Transform>();
 		m_GameObjects.push_back(go);
-		return m_GameObjects[m_GameObjects.size() - 1];
+		return go;
+	}
+
+	std::vector<GameObject> Scene::Instantiate(const Prefab& prefab, uint32_t count, const std::function<void(GameObject, uint32_t)>& initFn)
+	{
+		std::vector<GameObject> res;
+		if (count == 0)
+			return res;
+
+		std::vector<entt::entity> entities(count);
+		m_Registry.create(entities.begin(), entities.end());
+
+		const entt::entity* first = entities.data();
+		const entt::entity* last = first + count;
+
+		// 每个GameObject的UUID都不同, 先生成好再整段insert
+		std::vector<IDComponent> ids(count);
+		m_Registry.insert<IDComponent>(first, last, ids.begin());
+		m_Registry.insert<NameComponent>(first, last, NameComponent(prefab.GetName()));
+
+		for (const Prefab::PrototypeComponent& com : prefab.m_Components)
+			com.Insert(m_Registry, first, last, com.Prototype.get());
+
+		res.reserve(count);
+		m_GameObjects.reserve(m_GameObjects.size() + count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			res.emplace_back(entities[i], m_SceneIndex);
+			m_GameObjects.emplace_back(entities[i], m_SceneIndex);
+		}
+
+		if (initFn)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				initFn(res[i], i);
+		}
+
+		// 位置都设置好了, 这时再创建b2Body
+		CreatePendingBodies();
+		return res;
 	}
 
 	std::vector<GameObject>& Scene::GetGameObjects()
@@ -78,52 +278,467 @@ namespace Hazel
 		return m_GameObjects;
 	}
 
+	// InstanceId就是entt::entity的值, 直接问registry即可, 不需要遍历
 	bool Scene::GetGameObjectById(uint32_t id, GameObject& inOutGo)
 	{
-		for (size_t i = 0; i < m_GameObjects.size(); i++)
+		entt::entity entity = (entt::entity)id;
+		if (!m_Registry.valid(entity))
+			return false;
+
+		inOutGo = GameObject(entity, m_SceneIndex);
+		return true;
+	}
+
+	void Scene::DestroyGameObject(const GameObject& go)
+	{
+		std::vector<entt::entity> entities{ go };
+		DestroyGameObjects(entities);
+	}
+
+	void Scene::DestroyGameObjects(std::vector<entt::entity>& entities)
+	{
+		std::sort(entities.begin(), entities.end());
+		entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+		entities.erase(std::remove_if(entities.begin(), entities.end(),
+			[this](entt::entity e) { return !m_Registry.valid(e); }), entities.end());
+
+		if (entities.empty())
+			return;
+
+		m_GameObjects.erase(std::remove_if(m_GameObjects.begin(), m_GameObjects.end(), [&entities](const GameObject& go)
+			{
+				return std::binary_search(entities.begin(), entities.end(), (entt::entity)go);
+			}), m_GameObjects.end());
+
+		// registry.destroy会回收entity的id, 之后create时会复用(version加一)
+		m_Registry.destroy(entities.begin(), entities.end());
+	}
+
+	void Scene::AddToHierarchy(const std::vector<entt::entity>& entities)
+	{
+		m_GameObjects.reserve(m_GameObjects.size() + entities.size());
+		for (entt::entity entity : entities)
+			m_GameObjects.emplace_back(entity, m_SceneIndex);
+	}
+
+	void Scene::DestroyGameObjectById(uint32_t id)
+	{
+		GameObject go;
+		bool suc = GetGameObjectById(id, go);
+		if(suc)
+			DestroyGameObject(go);
+	}
+
+	void Scene::UpdateWorldMatrices()
+	{
+		// UpdateSpatialIndex会清空标记, 所以要先把标记过的Transform拷贝出来
+		if (m_AllTransformsMoved)
+		{
+			auto view = m_Registry.view<Transform>();
+			m_TransformStore.Clear();
+			m_TransformStore.Reserve(view.size());
+			for (auto [entity, t] : view.each())
+				m_TransformStore.Push(entity, t);
+		}
+		else
 		{
-			if (m_GameObjects[i].GetInstanceId() == id)
+			for (entt::entity entity : m_MovedTransforms)
 			{
-				inOutGo = m_GameObjects[i];
-				return true;
+				if (!m_Registry.valid(entity))
+					continue;
+
+				if (const Transform* t = m_Registry.try_get<Transform>(entity))
+					m_TransformStore.Push(entity, *t);
 			}
 		}
 
-		return false;
+		m_TransformStore.ComposeWorldMatrices();
+		UpdateSpatialIndex();
 	}
 
-	void Scene::DestroyGameObject(const GameObject& go)
+	// Sprite是局部空间里[-0.5, 0.5]的Quad, 用World Matrix的旋转缩放部分把半边长投影到XY轴上得到AABB
+	static void ComputeSpriteAABB(const glm::mat4& m, glm::vec2& outMin, glm::vec2& outMax)
+	{
+		glm::vec2 center = { m[3][0], m[3][1] };
+		glm::vec2 half =
+		{
+			0.5f * (std::abs(m[0][0]) + std::abs(m[1][0])),
+			0.5f * (std::abs(m[0][1]) + std::abs(m[1][1]))
+		};
+
+		outMin = center - half;
+		outMax = center + half;
+	}
+
+	// 只重新计算标记过的entity, 静止的物体没有任何开销
+	void Scene::UpdateSpatialIndex()
 	{
-		for (std::vector<GameObject>::iterator it = m_GameObjects.begin(); it != m_GameObjects.end(); it++)
+		glm::vec2 min, max;
+		if (m_AllTransformsMoved)
 		{
-			if (*it == go)
+			for (uint32_t i = 0; i < m_TransformStore.Size(); i++)
 			{
-				m_GameObjects.erase(it);
-				return;
+				ComputeSpriteAABB(m_TransformStore.GetWorldMatrix(i), min, max);
+				m_SpatialIndex.Update(m_TransformStore.GetEntity(i), min, max);
 			}
 		}
+		else
+		{
+			for (entt::entity entity : m_MovedTransforms)
+			{
+				// 标记以后又被销毁的entity已经在OnTransformDestroy里移除了
+				glm::mat4 world;
+				if (!m_Registry.valid(entity) || !m_TransformStore.TryGetWorldMatrix(entity, world))
+					continue;
+
+				ComputeSpriteAABB(world, min, max);
+				m_SpatialIndex.Update(entity, min, max);
+			}
+		}
+
+		for (entt::entity entity : m_MovedTransforms)
+			m_MovedMarks[entt::to_entity(entity)] = entt::null;
+		m_MovedTransforms.clear();
+		m_AllTransformsMoved = false;
 	}
 
-	void Scene::DestroyGameObjectById(uint32_t id)
+	void Scene::MarkTransformMoved(entt::entity entity)
 	{
-		GameObject go;
-		bool suc = GetGameObjectById(id, go);
-		if(suc)
-			DestroyGameObject(go);
+		if (m_AllTransformsMoved)
+			return;
+
+		std::lock_guard<std::mutex> lock(m_DirtyMutex);
+		uint32_t id = entt::to_entity(entity);
+		if (id >= m_MovedMarks.size())
+			m_MovedMarks.resize(id + 1, entt::null);
+
+		if (m_MovedMarks[id] != entity)
+		{
+			m_MovedMarks[id] = entity;
+			m_MovedTransforms.push_back(entity);
+		}
+	}
+
+	bool Scene::PickGameObject(const glm::vec2& worldPoint, GameObject& outGo) const
+	{
+		std::vector<entt::entity> candidates;
+		m_SpatialIndex.QueryPoint(worldPoint, candidates);
+
+		bool found = false;
+		float maxZ = 0.0f;
+		for (entt::entity entity : candidates)
+		{
+			glm::mat4 world;
+			if (!m_Registry.all_of<SpriteRenderer>(entity) || !m_TransformStore.TryGetWorldMatrix(entity, world))
+				continue;
+
+			// AABB只是粗筛, 变换回Quad的局部空间再做精确判断
+			glm::vec4 local = glm::inverse(world) * glm::vec4(worldPoint, world[3][2], 1.0f);
+			if (std::abs(local.x) > 0.5f || std::abs(local.y) > 0.5f)
+				continue;
+
+			if (!found || world[3][2] > maxZ)
+			{
+				found = true;
+				maxZ = world[3][2];
+				outGo = GameObject(entity, m_SceneIndex);
+			}
+		}
+
+		return found;
+	}
+
+	bool Scene::PickGameObject(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, GameObject& outGo) const
+	{
+		// 射线在XY平面上的投影是一条线段, 用它的AABB在SpatialIndex里粗筛
+		glm::vec2 a = glm::vec2(rayOrigin);
+		glm::vec2 b = glm::vec2(rayOrigin + rayDirection);
+		std::vector<entt::entity> candidates;
+		m_SpatialIndex.QueryAABB(glm::min(a, b), glm::max(a, b), candidates);
+
+		bool found = false;
+		float minT = 0.0f;
+		for (entt::entity entity : candidates)
+		{
+			glm::mat4 world;
+			if (!m_Registry.all_of<SpriteRenderer>(entity) || !m_TransformStore.TryGetWorldMatrix(entity, world))
+				continue;
+
+			// Quad所在的平面: 过World Matrix的平移, 法线是局部X轴与Y轴的叉积
+			glm::vec3 normal = glm::cross(glm::vec3(world[0]), glm::vec3(world[1]));
+			float denom = glm::dot(normal, rayDirection);
+			if (std::abs(denom) < 1e-8f)
+				continue;
+
+			float t = glm::dot(normal, glm::vec3(world[3]) - rayOrigin) / denom;
+			if (t < 0.0f || t > 1.0f || (found && t >= minT))
+				continue;
+
+			glm::vec4 local = glm::inverse(world) * glm::vec4(rayOrigin + t * rayDirection, 1.0f);
+			if (std::abs(local.x) > 0.5f || std::abs(local.y) > 0.5f)
+				continue;
+
+			found = true;
+			minT = t;
+			outGo = GameObject(entity, m_SceneIndex);
+		}
+
+		return found;
+	}
+
+	void Scene::ExtractRenderProxies(const glm::mat4& viewProjection)
+	{
+		glm::vec2 viewMin, viewMax;
+		SpatialIndex::ComputeViewBounds(viewProjection, m_TransformStore.GetMinZ(), m_TransformStore.GetMaxZ(), viewMin, viewMax);
+
+		m_VisibleEntities.clear();
+		m_SpatialIndex.QueryAABB(viewMin, viewMax, m_VisibleEntities);
+		std::sort(m_VisibleEntities.begin(), m_VisibleEntities.end());
+
+		m_SpriteProxies.clear();
+		for (entt::entity entity : m_VisibleEntities)
+		{
+			const SpriteRenderer* sprite = m_Registry.try_get<SpriteRenderer>(entity);
+			glm::mat4 world;
+			if (!sprite || !m_TransformStore.TryGetWorldMatrix(entity, world))
+				continue;
+
+			m_SpriteProxies.push_back({ world, sprite, (uint32_t)entity });
+		}
+	}
+
+	bool Scene::GetWorldMatrix(entt::entity entity, glm::mat4& outMat) const
+	{
+		return m_TransformStore.TryGetWorldMatrix(entity, outMat);
+	}
+
+	std::shared_ptr<const SceneSnapshot> Scene::Snapshot()
+	{
+		std::shared_ptr<SceneSnapshot> snapshot = std::make_shared<SceneSnapshot>();
+		snapshot->m_Entities.assign(m_Registry.data(), m_Registry.data() + m_Registry.size());
+		snapshot->m_Released = m_Registry.released();
+
+		snapshot->m_Hierarchy.reserve(m_GameObjects.size());
+		for (const GameObject& go : m_GameObjects)
+			snapshot->m_Hierarchy.push_back(go);
+
+		ForEachComponentType(AllComponentTypes{}, [this, &snapshot](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				constexpr size_t index = ComponentIndex<T, AllComponentTypes>::value;
+
+				if (m_PoolDirty[index] || !m_SyncedPools[index])
+					m_SyncedPools[index] = CapturePool<T>(m_Registry);
+
+				snapshot->m_Pools[index] = m_SyncedPools[index];
+				m_PoolDirty[index] = false;
+			});
+
+		return snapshot;
+	}
+
+	void Scene::Restore(const SceneSnapshot& snapshot)
+	{
+		// 数据没变的pool直接memcpy, entt不会发出信号
+		MarkAllTransformsMoved();
+
+		bool sameEntities = m_Registry.size() == snapshot.m_Entities.size() && m_Registry.released() == snapshot.m_Released
+			&& std::equal(snapshot.m_Entities.begin(), snapshot.m_Entities.end(), m_Registry.data());
+
+		// 有GameObject被创建或者销毁过, 只能清空registry, 连同entity的id一起还原
+		if (!sameEntities)
+		{
+			m_Registry.clear();
+			m_Registry.assign(snapshot.m_Entities.begin(), snapshot.m_Entities.end(), snapshot.m_Released);
+			for (auto& pool : m_SyncedPools)
+				pool.reset();
+		}
+
+		ForEachComponentType(AllComponentTypes{}, [this, &snapshot](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				constexpr size_t index = ComponentIndex<T, AllComponentTypes>::value;
+
+				if (!m_PoolDirty[index] && m_SyncedPools[index] == snapshot.m_Pools[index])
+					return;
+
+				RestorePool<T>(m_Registry, *snapshot.m_Pools[index]);
+				m_SyncedPools[index] = snapshot.m_Pools[index];
+				m_PoolDirty[index] = false;
+			});
+
+		m_GameObjects.clear();
+		AddToHierarchy(snapshot.m_Hierarchy);
+
+		// registry清空时所有GameObject都被记为销毁了, 还原出来的GameObject要重新写入
+		if (!sameEntities)
+		{
+			for (entt::entity entity : snapshot.m_Hierarchy)
+				MarkGameObjectDirty(entity);
+		}
+
+		// 快照里的Rigidbody2D都不带b2Body, 物理正在运行时按记录的位置和角度重新创建
+		if (m_PhysicsRunning)
+		{
+			for (auto [entity, rb] : m_Registry.view<Rigidbody2D>().each())
+			{
+				rb.SetEntity(entity);
+				if (!rb.GetBody())
+					rb.CreateBody(m_Physics.GetWorld());
+			}
+		}
+	}
+
+	void Scene::MarkDirty(entt::id_type type)
+	{
+		ForEachComponentType(AllComponentTypes{}, [this, type](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				if (entt::type_hash<T>::value() == type)
+					MarkDirty<T>();
+			});
+	}
+
+	void Scene::MarkAllDirty()
+	{
+		m_PoolDirty.fill(true);
+		MarkAllTransformsMoved();
+	}
+
+	void Scene::MarkGameObjectDirty(entt::entity entity)
+	{
+		if (!m_TrackGameObjectChanges)
+			return;
+
+		std::lock_guard<std::mutex> lock(m_DirtyMutex);
+		uint32_t id = entt::to_entity(entity);
+		if (id >= m_DirtyMarks.size())
+			m_DirtyMarks.resize(id + 1, entt::null);
+
+		if (m_DirtyMarks[id] != entity)
+		{
+			m_DirtyMarks[id] = entity;
+			m_DirtyGameObjects.push_back(entity);
+		}
+	}
+
+	void Scene::ConsumeDirtyGameObjects(std::vector<entt::entity>& outDirty, std::vector<uint64_t>& outRemoved)
+	{
+		std::lock_guard<std::mutex> lock(m_DirtyMutex);
+		// 标记之后又被销毁的GameObject已经记在m_RemovedUUIDs里了, 这里只返回还存在的
+		for (entt::entity entity : m_DirtyGameObjects)
+		{
+			m_DirtyMarks[entt::to_entity(entity)] = entt::null;
+			if (m_Registry.valid(entity) && m_Registry.all_of<IDComponent>(entity))
+				outDirty.push_back(entity);
+		}
+
+		outRemoved.insert(outRemoved.end(), m_RemovedUUIDs.begin(), m_RemovedUUIDs.end());
+		m_DirtyGameObjects.clear();
+		m_RemovedUUIDs.clear();
+	}
+
+	bool Scene::RollbackPhysics(uint64_t tick)
+	{
+		if (!m_PhysicsRunning || !m_Physics.Rollback(tick))
+			return false;
+
+		// 睡眠的b2Body也可能被挪动了, 不能再跳过; 插值的起点也要从还原后的状态开始
+		for (auto [entity, rb] : m_Registry.view<Rigidbody2D>().each())
+		{
+			rb.SetSyncedAsleep(false);
+			rb.SavePreviousState();
+		}
+
+		return true;
+	}
+
+	void Scene::StepPhysics(float deltaTime)
+	{
+		uint32_t steps = m_Physics.ConsumeSteps(deltaTime);
+
+		for (uint32_t i = 0; i < steps; i++)
+		{
+			// 只有最后一步之前的状态会参与插值, 睡眠的b2Body不会移动, 它记下的状态仍然有效
+			if (i + 1 == steps)
+			{
+				for (b2Body* body = m_Physics.GetWorld()->GetBodyList(); body; body = body->GetNext())
+				{
+					Rigidbody2D* rb = GetRigidbody2D(body);
+					if (rb && body->IsAwake())
+						rb->SavePreviousState();
+				}
+			}
+
+			m_Physics.Update();
+		}
+	}
+
+	// 物理世界是本Scene独有的, b2Body的UserData里存的entity一定属于本Scene
+	Rigidbody2D* Scene::GetRigidbody2D(b2Body* body)
+	{
+		entt::entity entity = (entt::entity)body->GetUserData().pointer;
+		return m_Registry.valid(entity) ? m_Registry.try_get<Rigidbody2D>(entity) : nullptr;
+	}
+
+	// entity的值只有在Component加到registry里以后才知道; Play期间新加的Rigidbody2D要马上创建b2Body
+	void Scene::OnRigidbody2DConstruct(entt::registry& registry, entt::entity entity)
+	{
+		Rigidbody2D& rb = registry.get<Rigidbody2D>(entity);
+		rb.SetEntity(entity);
+		if (m_PhysicsRunning && !rb.GetBody())
+			m_PendingBodies.push_back(entity);
+	}
+
+	void Scene::CreatePendingBodies()
+	{
+		for (entt::entity entity : m_PendingBodies)
+		{
+			// 排队以后又被删除, 或者Rigidbody2D已经被移除
+			if (!m_Registry.valid(entity))
+				continue;
+
+			Rigidbody2D* rb = m_Registry.try_get<Rigidbody2D>(entity);
+			if (!rb || rb->GetBody())
+				continue;
+
+			if (const Transform* t = m_Registry.try_get<Transform>(entity))
+				rb->SetPose({ t->Translation.x, t->Translation.y }, t->Rotation.z);
+
+			rb->CreateBody(m_Physics.GetWorld());
+		}
+
+		m_PendingBodies.clear();
 	}
 
 	void Scene::UpdateTransformsAfterPhysicsSim()
 	{
-		std::vector<GameObject>gos = GetGameObjectsByComponent<Rigidbody2D>();
+		// Transform位于上一步和当前步的物理状态之间, 渲染频率高于或者不等于物理频率时也不会卡顿
+		float alpha = m_Physics.GetInterpolationAlpha();
 
-		for (size_t i = 0; i < gos.size(); i++)
+		// 直接遍历b2World的body列表, 静态的和已经同步过的睡眠b2Body都跳过
+		for (b2Body* body = m_Physics.GetWorld()->GetBodyList(); body; body = body->GetNext())
 		{
-			Rigidbody2D& rb = gos[i].GetComponent<Rigidbody2D>();
-			Transform& t = gos[i].GetComponent<Transform>();
+			if (body->GetType() == b2_staticBody)
+				continue;
+
+			bool asleep = !body->IsAwake();
+			Rigidbody2D* rb = GetRigidbody2D(body);
+			if (!rb || (asleep && rb->IsSyncedAsleep()))
+				continue;
+
+			Transform* t = m_Registry.try_get<Transform>(rb->GetEntity());
+			if (!t)
+				continue;
 
-			t.Translation.x = rb.GetLocation().x;
-			t.Translation.y = rb.GetLocation().y;
-			t.Rotation.z = rb.GetAngle();
+			// 刚睡眠的b2Body不再插值, 直接停在最终的位置上
+			float a = asleep ? 1.0f : alpha;
+			glm::vec2 pos = rb->GetInterpolatedLocation(a);
+			t->Translation.x = pos.x;
+			t->Translation.y = pos.y;
+			t->Rotation.z = rb->GetInterpolatedAngle(a);
+			rb->SetSyncedAsleep(asleep);
+			MarkTransformMoved(rb->GetEntity());
 		}
 	}
 }
@@ -3,16 +3,41 @@
 #include "entt.hpp"
 #include "GameObject.h"
 #include "Components/Component.h"
+#include "TransformStore.h"
+#include "SystemScheduler.h"
+#include "Prefab.h"
+#include "EntityCommandBuffer.h"
+#include "SceneSnapshot.h"
+#include "SpatialIndex.h"
+#include "Physics/Physics2D.h"
+#include <atomic>
+#include <mutex>
 
 namespace Hazel
 {
 	class GameObject;
+	class SpriteRenderer;
+
+	// 渲染时需要的Sprite数据, 由Scene::ExtractRenderProxies把相机看得到的Sprite打包成连续数组
+	struct SpriteRenderProxy
+	{
+		glm::mat4 World;
+		const SpriteRenderer* Sprite;
+		uint32_t InstanceId;
+	};
+
 	class Scene
 	{
+		friend class EntityCommandBuffer;
+		friend class BinarySceneSerializer;
+		friend class SceneSerializer;
 	public:
 		Scene();
 		~Scene();
 
+		Scene(const Scene&) = delete;
+		Scene& operator=(const Scene&) = delete;
+
 		void Begin();
 		void Pause();
 		void Stop();
@@ -24,10 +49,20 @@ namespace Hazel
 		// TODO: 删除所有的GameObjects in scene
 		void ClearAllGameObjectsInScene();
 
-		GameObject& CreateGameObjectInScene(const std::shared_ptr<Scene>& ps, const std::string& name = "Default Name");
-		GameObject& CreateGameObjectInSceneWithUUID(const std::shared_ptr<Scene>& ps, const uint64_t& id, const std::string& name = "Default Name");
+		// GameObject只是句柄, 按值返回即可
+		GameObject CreateGameObjectInScene(const std::string& name = "Default Name");
+		GameObject CreateGameObjectInSceneWithUUID(const uint64_t& id, const std::string& name = "Default Name");
+		// 批量创建count个GameObject: 一次性create所有entity, 每种Component用registry.insert整段写入
+		// initFn(go, index)在所有Component都创建好之后, 对每个GameObject调用一次, 用来设置位置等逐个不同的数据
+		// Play期间Prefab里的Rigidbody2D在initFn之后才创建b2Body, 用的是initFn设置好的位置
+		std::vector<GameObject> Instantiate(const Prefab& prefab, uint32_t count,
+			const std::function<void(GameObject, uint32_t)>& initFn = nullptr);
+
 		std::vector<GameObject>& GetGameObjects();// 一定返回的是&, 这里引起过Bug
 		bool GetGameObjectById(uint32_t id, GameObject& inOutGo);
+
+		// 此Scene在全局Scene表里的句柄(槽位加generation), GameObject句柄里存的就是它
+		uint32_t GetSceneIndex() const { return m_SceneIndex; }
 		
 		// TODO: 没有想到更好的办法能不用raw pointers, 如果返回shared_ptr, 则外部会在调用后, 
 		// 会因为引用计数变为0而销毁T对象
@@ -57,18 +92,15 @@ namespace Hazel
 			return m_Registry.get<T>(go);
 		}
 
-		// TODO: 后续可能要返回GameObject的指针
+		// GameObject是8字节的句柄, 直接根据view里的entity构造即可
 		template<class T>
 		std::vector<GameObject> GetGameObjectsByComponent()
 		{
 			std::vector<GameObject> res;
-			auto group = m_Registry.view<T>();
-			for (auto entity : group)
-			{
-				std::vector<GameObject>::iterator itr =std::find(m_GameObjects.begin(), m_GameObjects.end(), entity);
-				if (itr != m_GameObjects.end())
-					res.push_back(*itr);
-			}
+			auto view = m_Registry.view<T>();
+			res.reserve(view.size());
+			for (auto entity : view)
+				res.emplace_back(entity, m_SceneIndex);
 
 			return res;
 		}
@@ -78,14 +110,149 @@ namespace Hazel
 
 		void DestroyGameObject(const GameObject& go);
 
+		// 批量销毁: 排序去重以后, 一次遍历m_GameObjects删除, 再整段调用registry.destroy, 总体是线性的
+		// 传入的数组会被修改
+		void DestroyGameObjects(std::vector<entt::entity>& entities);
+
+		// System执行期间的结构性修改(创建、销毁GameObject, 增删Component)都录制到这里, 在Update的最后统一执行
+		EntityCommandBuffer& GetCommandBuffer() { return m_CommandBuffer; }
+
 		void DestroyGameObjectById(uint32_t id);
 
+		// 只把标记过移动的Transform拷贝到TransformStore里批量计算World Matrix, 其余的沿用上一帧的结果
+		// MarkAllTransformsMoved以后(比如Restore)才会重新拷贝全部Transform
+		// 每帧在渲染之前调用一次即可, 同一帧里多次渲染(Viewport和CameraComponent)共享计算结果
+		void UpdateWorldMatrices();
+		bool GetWorldMatrix(entt::entity entity, glm::mat4& outMat) const;
+		const TransformStore& GetTransformStore() const { return m_TransformStore; }
+
+		// 在UpdateWorldMatrices之后、每次渲染之前调用, 用SpatialIndex剔除相机看不到的Sprite, 剩下的生成渲染用的数组
+		// 同一帧里每个相机调用一次, 结果按entity排序, 保证每帧的绘制顺序稳定
+		void ExtractRenderProxies(const glm::mat4& viewProjection);
+		const std::vector<SpriteRenderProxy>& GetSpriteRenderProxies() const { return m_SpriteProxies; }
+
+		// UpdateWorldMatrices会顺带把AABB增量更新到这里, 拾取、剔除和范围查询都用它
+		const SpatialIndex& GetSpatialIndex() const { return m_SpatialIndex; }
+
+		// 只有标记过的entity会在下一次UpdateWorldMatrices里重新计算World Matrix和AABB
+		// Transform的创建和patch/replace会自动标记, MarkDirty<Transform>(entity)也会标记;
+		// System声明了Writes<Transform>但没有声明MarksWrittenEntities时, 每帧都会重新检查所有Transform
+		// 可以在并行执行的System里调用, 内部有锁
+		void MarkTransformMoved(entt::entity entity);
+		void MarkAllTransformsMoved() { m_AllTransformsMoved = true; }
+
+		// 找到XY平面上包含worldPoint的Sprite, 有多个时返回Z最大(最靠近相机)的那个
+		bool PickGameObject(const glm::vec2& worldPoint, GameObject& outGo) const;
+		// 用射线与每个候选Sprite所在的平面求交, 返回离rayOrigin最近的那个, 透视相机下Z不为0的Sprite也能正确拾取
+		// 射线上的点为rayOrigin + t * rayDirection, 只考虑t在[0, 1]之间的部分(比如近裁剪面到远裁剪面)
+		bool PickGameObject(const glm::vec3& rayOrigin, const glm::vec3& rayDirection, GameObject& outGo) const;
+
+		// 拷贝整个Scene的状态, 用于Play之前保存编辑状态, Stop时再用Restore还原
+		// trivially relocatable的Component按page整块memcpy, 自上次Snapshot以来没有改过的pool直接共享
+		std::shared_ptr<const SceneSnapshot> Snapshot();
+		void Restore(const SceneSnapshot& snapshot);
+
+		// 增删Component会自动标记, 但通过引用直接修改Component的数据时entt无从得知,
+		// 这时需要调用MarkDirty, 否则Snapshot会误以为这个pool没有变化
+		template<class T>
+		void MarkDirty() { m_PoolDirty[ComponentIndex<T, AllComponentTypes>::value] = true; }
+		// 知道改的是哪个GameObject时用这个版本, 增量保存只会重新写出被标记过的GameObject
+		// 可以在System里调用: 不冲突的System会并行执行, 记录脏GameObject的列表由m_DirtyMutex保护
+		// (registry.patch、emplace通过OnPoolChanged也会走到这里)
+		template<class T>
+		void MarkDirty(entt::entity entity)
+		{
+			MarkDirty<T>();
+			MarkGameObjectDirty(entity);
+			if constexpr (std::is_same<T, Transform>::value)
+				MarkTransformMoved(entity);
+		}
+		void MarkDirty(entt::id_type type);
+		void MarkAllDirty();
+
+		// 自上次ConsumeDirtyGameObjects以来改过的GameObject, 以及被销毁的GameObject的UUID, 用于增量保存
+		// 增删Component会自动记录, 通过引用直接修改Component数据时需要调用MarkDirty<T>(entity)
+		void MarkGameObjectDirty(entt::entity entity);
+		void ConsumeDirtyGameObjects(std::vector<entt::entity>& outDirty, std::vector<uint64_t>& outRemoved);
+		// 关闭期间创建、修改和删除GameObject都不会被记录, 用于WorldPartition流式加载和卸载只读的格子
+		// Component的pool标记和SpatialIndex的更新不受影响
+		void SetGameObjectChangeTracking(bool enabled) { m_TrackGameObjectChanges = enabled; }
+
+		// 本Scene独有的物理世界, 不同Scene可以在不同线程里同时Update
+		Physics2D& GetPhysics2D() { return m_Physics; }
+		// 本帧物理模拟产生的接触事件, 加上上一帧所有System执行完以后(比如删除b2Body时)产生的事件
+		// Update里所有System执行完以后清空, 用PhysicsContactEvent::Tick区分是哪一步产生的
+		const std::vector<PhysicsContactEvent>& GetContactEvents() const { return m_Physics.GetContactEvents(); }
+
+		// 物理回滚到第tick步(需要先Physics2D::EnableHistory), 并让下一次TransformSync重新同步所有b2Body
+		// 之后由调用者重新施加输入并调用GetPhysics2D().Resimulate, 用于回滚式网络同步和录像拖动
+		bool RollbackPhysics(uint64_t tick);
+
+		// Update里执行的System都注册在这里, 游戏逻辑、动画、AI等System通过AddSystem添加
+		SystemScheduler& GetSystemScheduler() { return m_Scheduler; }
+		const std::vector<SystemScheduler::SystemTiming>& GetSystemTimings() const { return m_Scheduler.GetTimings(); }
+
 	private:
+		void StartPhysics();
+		void StopPhysics();
+		void StepPhysics(float deltaTime);
 		void UpdateTransformsAfterPhysicsSim();
+		Rigidbody2D* GetRigidbody2D(b2Body* body);
+		void OnRigidbody2DConstruct(entt::registry& registry, entt::entity entity);
+		// 用最终的Transform为Play期间新加的Rigidbody2D创建b2Body
+		void CreatePendingBodies();
+		void AddToHierarchy(const std::vector<entt::entity>& entities);
+		void UpdateSpatialIndex();
+		void OnTransformDestroy(entt::registry&, entt::entity entity)
+		{
+			m_SpatialIndex.Remove(entity);
+			m_TransformStore.Remove(entity);
+		}
+
+		template<class T>
+		void OnPoolChanged(entt::registry&, entt::entity entity) { MarkDirty<T>(entity); }
+		void OnIDComponentDestroy(entt::registry& registry, entt::entity entity)
+		{
+			if (!m_TrackGameObjectChanges)
+				return;
+
+			std::lock_guard<std::mutex> lock(m_DirtyMutex);
+			m_RemovedUUIDs.push_back(registry.get<IDComponent>(entity).ID);
+		}
 
 
 	private:
+		Physics2D m_Physics;// 要比m_Registry后析构, registry清空时会删除其中的b2Body
 		entt::registry m_Registry;
-		std::vector<GameObject> m_GameObjects;
+		uint32_t m_SceneIndex;
+		std::vector<GameObject> m_GameObjects;// 只用来保存Hierarchy里的顺序
+		TransformStore m_TransformStore;
+		std::vector<SpriteRenderProxy> m_SpriteProxies;
+		std::vector<entt::entity> m_VisibleEntities;// ExtractRenderProxies的查询结果, 保留容量避免每帧分配
+		SpatialIndex m_SpatialIndex;
+		bool m_PhysicsRunning = false;// Begin到Stop之间为true, 只有这期间Rigidbody2D才有b2Body
+		// Play期间新加了Rigidbody2D、还没有创建b2Body的entity
+		// 等Instantiate的initFn、CommandBuffer的Playback把Transform设置好以后再创建, 否则b2Body会停在Prefab的位置
+		std::vector<entt::entity> m_PendingBodies;
+		SystemScheduler m_Scheduler;
+		EntityCommandBuffer m_CommandBuffer;
+
+		// 每个注册过的Component pool, 自从与m_SyncedPools里的拷贝一致以后, 是否又被修改过
+		std::array<bool, AllComponentTypes::Count> m_PoolDirty;
+		std::array<std::shared_ptr<const SceneSnapshot::ComponentPool>, AllComponentTypes::Count> m_SyncedPools;
+
+		// 增量保存用的脏标记, m_DirtyMarks以entity的id(不含version)为下标, 记录被标记的entity(含version)
+		// 保证每个GameObject只记录一次, id被复用以后的新GameObject也会被记录
+		std::vector<entt::entity> m_DirtyGameObjects;
+		std::vector<entt::entity> m_DirtyMarks;
+		std::vector<uint64_t> m_RemovedUUIDs;
+		// 保护m_DirtyGameObjects、m_RemovedUUIDs、m_MovedTransforms和对应的标记数组
+		std::mutex m_DirtyMutex;
+		bool m_TrackGameObjectChanges = true;
+
+		// SpatialIndex的增量更新, 标记方式与m_DirtyMarks相同
+		std::vector<entt::entity> m_MovedTransforms;
+		std::vector<entt::entity> m_MovedMarks;
+		std::atomic<bool> m_AllTransformsMoved = true;
 	};
 }
\ No newline at end of file
@@ -3,13 +3,17 @@
 #include "ECS/GameObject.h"
 #include "ECS/Components/Transform.h"
 #include "ECS/Components/CameraComponent.h"
+#include "ECS/Components/ComponentReflection.h"
 #include "imgui.h"
 #include "imgui_internal.h"
 
 namespace Hazel
 {
-	static void DrawVec3Control(const std::string& label, glm::vec3& values, float resetValue = 0.0f, float columnWidth = 100.0f)
+	// 返回值表示这一帧是否修改了values
+	static bool DrawVec3Control(const std::string& label, glm::vec3& values, float resetValue = 0.0f, float columnWidth = 100.0f)
 	{
+		bool changed = false;
+
 		// Translation、Scale都会有相同的类似DragFloat("##Y"的函数, 而ImGui是根据输入的"##Y"来作为identifier的
 		// 为了让不同组件的相同名字的值可以各自通过UI读写, 这里需要在绘制最开始加入ID, 绘制结束后PopId
 		ImGui::PushID(label.c_str());
@@ -39,13 +43,16 @@ namespace Hazel
 		ImGui::PushFont(fontAtlas.Fonts[1]);
 		// 按X按钮重置x值
 		if (ImGui::Button("X", buttonSize))
+		{
 			values.x = resetValue;
+			changed = true;
+		}
 		ImGui::PopStyleColor(3);// 把上面Push的三个StyleColor给拿出来
 		ImGui::PopFont();
 
 		// 把x值显示出来, 同时提供拖拽修改功能
 		ImGui::SameLine();
-		ImGui::DragFloat("##X", &values.x, 0.1f, 0.0f, 0.0f, "%.2f");
+		changed |= ImGui::DragFloat("##X", &values.x, 0.1f, 0.0f, 0.0f, "%.2f");
 		ImGui::PopItemWidth();
 		ImGui::SameLine();
 
@@ -55,12 +62,15 @@ namespace Hazel
 		ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4{ 0.2f, 0.7f, 0.2f, 1.0f });
 		ImGui::PushFont(fontAtlas.Fonts[1]);
 		if (ImGui::Button("Y", buttonSize))
+		{
 			values.y = resetValue;
+			changed = true;
+		}
 		ImGui::PopFont();
 		ImGui::PopStyleColor(3);
 
 		ImGui::SameLine();
-		ImGui::DragFloat("##Y", &values.y, 0.1f, 0.0f, 0.0f, "%.2f");
+		changed |= ImGui::DragFloat("##Y", &values.y, 0.1f, 0.0f, 0.0f, "%.2f");
 		ImGui::PopItemWidth();
 		ImGui::SameLine();
 
@@ -70,12 +80,15 @@ namespace Hazel
 		ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4{ 0.1f, 0.25f, 0.8f, 1.0f });
 		ImGui::PushFont(fontAtlas.Fonts[1]);
 		if (ImGui::Button("Z", buttonSize))
+		{
 			values.z = resetValue;
+			changed = true;
+		}
 		ImGui::PopFont();
 		ImGui::PopStyleColor(3);
 
 		ImGui::SameLine();
-		ImGui::DragFloat("##Z", &values.z, 0.1f, 0.0f, 0.0f, "%.2f");// 小数点后2位
+		changed |= ImGui::DragFloat("##Z", &values.z, 0.1f, 0.0f, 0.0f, "%.2f");// 小数点后2位
 		ImGui::PopItemWidth();
 
 		// 与前面的PushStyleVar相对应
@@ -84,6 +97,166 @@ namespace Hazel
 		ImGui::Columns(1);
 
 		ImGui::PopID();
+		return changed;
+	}
+
+	// 按字段表绘制一个字段, 值变化时才通过Set写回Component, 并返回true
+	static bool DrawField(const FieldInfo& field, void* com)
+	{
+		bool changed = false;
+		switch (field.Type)
+		{
+		case FieldType::Bool:
+		{
+			bool value;
+			field.Get(com, &value);
+			if (ImGui::Checkbox(field.Name, &value))
+			{
+				field.Set(com, &value);
+				changed = true;
+			}
+			break;
+		}
+		case FieldType::Int:
+		{
+			int value;
+			field.Get(com, &value);
+			// 枚举字段绘制成下拉框, 选项的顺序与枚举值相同
+			int old = value;
+			bool edited = field.EnumCount > 0 ? ImGui::Combo(field.Name, &value, field.EnumNames, (int)field.EnumCount)
+				: ImGui::DragInt(field.Name, &value);
+			if (edited && value != old)
+			{
+				field.Set(com, &value);
+				changed = true;
+			}
+			break;
+		}
+		case FieldType::Float:
+		{
+			float value;
+			field.Get(com, &value);
+			if (field.Flags & FieldFlags_Angle)
+			{
+				float degrees = glm::degrees(value);
+				if (ImGui::DragFloat(field.Name, &degrees, 0.5f))
+				{
+					value = glm::radians(degrees);
+					field.Set(com, &value);
+					changed = true;
+				}
+			}
+			else
+			{
+				// 有范围时按范围的1%拖动, 比如Friction这种[0, 1]之间的值
+				float speed = field.Max > field.Min ? std::min<float>(0.1f, (field.Max - field.Min) * 0.01f) : 0.1f;
+				if (ImGui::DragFloat(field.Name, &value, speed, field.Min, field.Max))
+				{
+					field.Set(com, &value);
+					changed = true;
+				}
+			}
+			break;
+		}
+		case FieldType::Vec2:
+		{
+			glm::vec2 value;
+			field.Get(com, &value);
+			if (ImGui::DragFloat2(field.Name, glm::value_ptr(value), 0.1f))
+			{
+				field.Set(com, &value);
+				changed = true;
+			}
+			break;
+		}
+		case FieldType::Vec3:
+		{
+			glm::vec3 value;
+			field.Get(com, &value);
+			// 面板上展示的是degrees, 但是底层数据存的是radians
+			if (field.Flags & FieldFlags_Angle)
+				value = glm::degrees(value);
+
+			if (DrawVec3Control(field.Name, value, (field.Flags & FieldFlags_DefaultOne) ? 1.0f : 0.0f))
+			{
+				if (field.Flags & FieldFlags_Angle)
+					value = glm::radians(value);
+				field.Set(com, &value);
+				changed = true;
+			}
+			break;
+		}
+		case FieldType::Vec4:
+		{
+			glm::vec4 value;
+			field.Get(com, &value);
+			bool edited = (field.Flags & FieldFlags_Color) ? ImGui::ColorEdit4(field.Name, glm::value_ptr(value))
+				: ImGui::DragFloat4(field.Name, glm::value_ptr(value), 0.1f);
+			if (edited)
+			{
+				field.Set(com, &value);
+				changed = true;
+			}
+			break;
+		}
+		case FieldType::String:
+		{
+			std::string value;
+			field.Get(com, &value);
+			char buffer[256] = {};
+			strncpy(buffer, value.c_str(), sizeof(buffer) - 1);
+			if (ImGui::InputText(field.Name, buffer, sizeof(buffer)))
+			{
+				value = buffer;
+				field.Set(com, &value);
+				changed = true;
+			}
+			break;
+		}
+		case FieldType::Vec2List:
+		{
+			// 只能编辑已有的元素, 数量由Component自己决定(比如Rigidbody2D的顶点)
+			std::vector<glm::vec2> value;
+			field.Get(com, &value);
+			ImGui::Text(field.Name);
+			bool edited = false;
+			for (size_t i = 0; i < value.size(); i++)
+			{
+				ImGui::PushID((int)i);
+				edited |= ImGui::DragFloat2("##Item", glm::value_ptr(value[i]), 0.05f);
+				ImGui::PopID();
+			}
+
+			if (edited)
+			{
+				field.Set(com, &value);
+				changed = true;
+			}
+			break;
+		}
+		default:
+			// UInt64只有IDComponent在用, 它不在Inspector里显示
+			break;
+		}
+
+		return changed;
+	}
+
+	template<class T>
+	static bool DrawReflectedFields(T& com)
+	{
+		static_assert(ComponentTraits<T>::EditorVisible, "Only EditorVisible components are drawn in the inspector");
+		bool changed = false;
+		for (const FieldInfo& field : ComponentReflection<T>::Fields)
+		{
+			if (field.Visible && !field.Visible(&com))
+				continue;
+
+			ImGui::PushID(field.Name);
+			changed |= DrawField(field, &com);
+			ImGui::PopID();
+		}
+		return changed;
 	}
 
 	// SceneHierarchyPanel分为两个子窗口, Hierarchy窗口和Inspector窗口
@@ -109,7 +282,7 @@ namespace Hazel
 			{
 				// 这里的快捷键只是一个说明, 还要手动实现对应的Event Callback
 				if (ImGui::MenuItem("Create New GameObject", "Ctrl+Alt+N"))
-					m_Scene->CreateGameObjectInScene(m_Scene, "New GameObject");
+					m_Scene->CreateGameObjectInScene("New GameObject");
 
 				ImGui::EndPopup();
 			}
@@ -210,7 +383,7 @@ namespace Hazel
 
 		if (ImGui::BeginPopup("AddComponent"))
 		{
-			if (ImGui::MenuItem("Camera"))
+			if (ComponentTraits<CameraComponent>::EditorVisible && ImGui::MenuItem("Camera"))
 			{
 				if (!go.HasComponent<CameraComponent>())
 					go.AddComponent<CameraComponent>();
@@ -218,7 +391,7 @@ namespace Hazel
 				ImGui::CloseCurrentPopup();
 			}
 
-			if (ImGui::MenuItem("Sprite Renderer"))
+			if (ComponentTraits<SpriteRenderer>::EditorVisible && ImGui::MenuItem("Sprite Renderer"))
 			{
 				if (!go.HasComponent<SpriteRenderer>())
 					go.AddComponent<SpriteRenderer>();
@@ -226,7 +399,7 @@ namespace Hazel
 				ImGui::CloseCurrentPopup();
 			}
 
-			if (ImGui::MenuItem("Rigidbody2D"))
+			if (ComponentTraits<Rigidbody2D>::EditorVisible && ImGui::MenuItem("Rigidbody2D"))
 			{
 				glm::vec3& pos = go.GetPosition();
 				glm::vec3& rot = go.GetRotation();
@@ -244,90 +417,13 @@ namespace Hazel
 		HAZEL_ASSERT(go.HasComponent<Transform>(), "Invalid GameObject Without Transform Component!");
 		if (go.HasComponent<Transform>())
 		{
-			DrawComponent<Transform>("Transform", go, [](Transform& tc)
-				{
-					DrawVec3Control("Translation", tc.Translation);
-					// 面板上展示的是degrees, 但是底层数据存的是radians
-					glm::vec3 rotation = glm::degrees(tc.Rotation);
-					DrawVec3Control("Rotation", rotation);
-					tc.Rotation = glm::radians(rotation);
-					DrawVec3Control("Scale", tc.Scale, 1.0f);
-				}
-			);
+			DrawComponent<Transform>("Transform", go, [](Transform& tc) { return DrawReflectedFields(tc); });
 		}
 
 		// 4. Draw Camera Component
 		if (go.HasComponent<CameraComponent>())
 		{
-			DrawComponent<CameraComponent>("CameraComponent", go, [](CameraComponent& cam)
-				{
-					// 绘制俩选项, 这里的选项顺序与ProjectionType的枚举顺序相同
-					const char* projectionTypeStrings[] = { "Perspective", "Orthographic" };
-					// 当前选项从数组中找
-					const char* currentProjectionTypeString = projectionTypeStrings[(int)cam.GetProjectionType()];
-
-					bool projectionTypeChanged = false;
-
-					// BeginCombo是ImGui绘制EnumPopup的方法
-					if (ImGui::BeginCombo("Projection", currentProjectionTypeString))
-					{
-						for (int i = 0; i < 2; i++)
-						{
-							bool isSelected = currentProjectionTypeString == projectionTypeStrings[i];
-							if (ImGui::Selectable(projectionTypeStrings[i], isSelected))
-							{
-								if (cam.GetProjectionType() != (CameraComponent::ProjectionType)i)
-								{
-									currentProjectionTypeString = projectionTypeStrings[i];
-									cam.SetProjectionType((CameraComponent::ProjectionType)i);
-									projectionTypeChanged = true;
-								}
-							}
-
-							// 高亮当前已经选择的Item
-							if (isSelected)
-								ImGui::SetItemDefaultFocus();
-						}
-
-						ImGui::EndCombo();
-					}
-
-					if (cam.GetProjectionType() == CameraComponent::ProjectionType::Perspective)
-					{
-						float verticalFov = glm::degrees(cam.GetPerspectiveVerticalFOV());
-						if (ImGui::DragFloat("Vertical FOV", &verticalFov))
-							cam.SetPerspectiveVerticalFOV(glm::radians(verticalFov));
-
-						float orthoNear = cam.GetPerspectiveNearClip();
-						if (ImGui::DragFloat("Near", &orthoNear))
-							cam.SetPerspectiveNearClip(orthoNear);
-
-						float orthoFar = cam.GetPerspectiveFarClip();
-						if (ImGui::DragFloat("Far", &orthoFar))
-							cam.SetPerspectiveFarClip(orthoFar);
-					}
-
-					if (cam.GetProjectionType() == CameraComponent::ProjectionType::Orthographic)
-					{
-						float orthoSize = cam.GetOrthographicSize();
-						if (ImGui::DragFloat("Size", &orthoSize))
-							cam.SetOrthographicSize(orthoSize);
-
-						float orthoNear = cam.GetOrthographicNearClip();
-						if (ImGui::DragFloat("Near", &orthoNear))
-							cam.SetOrthographicNearClip(orthoNear);
-
-						float orthoFar = cam.GetOrthographicFarClip();
-						if (ImGui::DragFloat("Far", &orthoFar))
-							cam.SetOrthographicFarClip(orthoFar);
-
-						ImGui::Checkbox("Fixed Aspect Ratio", &cam.GetFixedAspectRatio());
-					}
-
-					if (projectionTypeChanged)
-						cam.RecalculateProjectionMat();
-				}
-			);
+			DrawComponent<CameraComponent>("CameraComponent", go, [](CameraComponent& cam) { return DrawReflectedFields(cam); });
 		}
 	
 		// 5. Draw SpriteRendererComponent
@@ -335,7 +431,7 @@ namespace Hazel
 		{
 			DrawComponent<SpriteRenderer>("SpriteRenderer", go, [](SpriteRenderer& sr)
 			{
-				ImGui::ColorEdit4("Color", glm::value_ptr(sr.GetTintColor()));
+				bool changed = DrawReflectedFields(sr);
 
 				// 贴图槽位其实是用Button绘制的, 这里并没有绘制出贴图的略缩图
 				ImGui::Button("Texture", ImVec2(100.0f, 0.0f));
@@ -347,89 +443,19 @@ namespace Hazel
 						const char* path = (const char*)payload->Data;
 						std::filesystem::path texturePath = path;
 						sr.SetTexture(Texture2D::Create(texturePath.string()));
+						changed = true;
 					}
 					ImGui::EndDragDropTarget();
 				}
 
-				ImGui::DragFloat("Tiling Factor X", &sr.GetTilingFactor().x, 0.1f, 0.0f, 100.0f);
-				ImGui::DragFloat("Tiling Factor Y", &sr.GetTilingFactor().y, 0.1f, 0.0f, 100.0f);
+				return changed;
 			});
 		}
 
 		// 6. Draw Rigidbody2DComponent
 		if (go.HasComponent<Rigidbody2D>())
 		{
-			DrawComponent<Rigidbody2D>("Rigidbody2D", go, [](Rigidbody2D& rb)
-				{
-					// TODO: 这种绘制Menu的东西应该封装一下
-
-					const int typesCnt = 3;
-					const char* typeChoices[typesCnt] = { "Static", "Dynamic", "Kinematic" };
-					// 当前选项从数组中找
-					const char* curChoice = typeChoices[(int)rb.GetType()];
-
-					//bool bTypeChanged = false;
-
-					if (ImGui::BeginCombo(" ", curChoice))
-					{
-						for (int i = 0; i < typesCnt; i++)
-						{
-							bool isSelected = curChoice == typeChoices[i];
-							if (ImGui::Selectable(typeChoices[i], isSelected))
-							{
-								if ((int)rb.GetType() != i)
-								{
-									curChoice = typeChoices[i];
-									rb.SetType((Rigidbody2DType)i);
-									//bTypeChanged = true;
-								}
-							}
-
-							// 高亮当前已经选择的Item
-							if (isSelected)
-								ImGui::SetItemDefaultFocus();
-						}
-
-						ImGui::EndCombo();
-					}
-
-					// 临时绘制Vec3代表Vec2
-					glm::vec3 ext(rb.GetExtents().x, rb.GetExtents().y, 0);
-					DrawVec3Control("BoxExtent", ext);
-					rb.GetExtents() = { ext.x, ext.y };
-
-					//	const int shapsCnt = 4;
-					//	const char* shapesChoices[typesCnt] = { "Box", "CirCle", "Polygon", "Line" };
-					//	// 当前选项从数组中找
-					//	const char* curChoice = typeChoices[(int)rb.GetType()];
-
-					//	//bool bTypeChanged = false;
-
-					//	// BeginCombo是ImGui绘制EnumPopup的方法
-					//	if (ImGui::BeginCombo("", curChoice))
-					//	{
-					//		for (int i = 0; i < typesCnt; i++)
-					//		{
-					//			bool isSelected = curChoice == typeChoices[i];
-					//			if (ImGui::Selectable(typeChoices[i], isSelected))
-					//			{
-					//				if ((int)rb.GetType() != i)
-					//				{
-					//					curChoice = typeChoices[i];
-					//					rb.SetType((Rigidbody2DType)i);
-					//					//bTypeChanged = true;
-					//				}
-					//			}
-
-					//			// 高亮当前已经选择的Item
-					//			if (isSelected)
-					//				ImGui::SetItemDefaultFocus();
-					//		}
-
-					//		ImGui::EndCombo();
-					//	
-				
-				});
+			DrawComponent<Rigidbody2D>("Rigidbody2D", go, [](Rigidbody2D& rb) { return DrawReflectedFields(rb); });
 		}
 	}
 
@@ -22,8 +22,12 @@ namespace Hazel
 
 	private:
 		template<class T>
-		void DrawComponent(const char* name, GameObject& go, std::function<void(T&)> uiFunction)
+		void DrawComponent(const char* name, GameObject& go, std::function<bool(T&)> uiFunction)
 		{
+			// ComponentRegistry.h里注册为EditorVisible的Component才在Inspector里显示
+			if constexpr (!ComponentTraits<T>::EditorVisible)
+				return;
+
 			ImGuiTreeNodeFlags flag = ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_SpanAvailWidth | ImGuiTreeNodeFlags_FramePadding;
 
 			// 1. 绘制通用的右上角的按钮
@@ -60,8 +64,10 @@ namespace Hazel
 
 			if (openComponentDetails && open)
 			{
+				// uiFunction返回这一帧是否改了Component, 只有改了才标记, 否则Snapshot没法共享pool, 增量保存也会重复写出
 				T& tc = go.GetComponent<T>();
-				uiFunction(tc);
+				if (uiFunction(tc))
+					m_Scene->MarkDirty<T>(go);
 			}
 
 			if(open)
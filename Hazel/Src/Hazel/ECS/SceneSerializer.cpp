@@ -2,201 +2,816 @@
 #include "SceneSerializer.h"
 #include "Scene.h"
 #include "Components/Transform.h"
+#include "Components/ComponentReflection.h"
+#include "BinarySceneSerializer.h"
+#include "Hazel/Core/JobSystem.h"
+#include <optional>
+#include <tuple>
 
 namespace Hazel 
 {
-	void SceneSerializer::Serialize(std::shared_ptr<Scene> scene, const char* savePath)
+	// 在YAML里作为GameObject下一个单独的map写出的Component, 也就是字段表里SerializedName不为空的那些
+	template<class T>
+	constexpr bool IsYamlSection()
 	{
-		YAML::Emitter out;
-		out << YAML::BeginMap;
-		out << YAML::Key << "Scene" << YAML::Value << "Untitled";
-		out << YAML::Key << "GameObjects" << YAML::Value << YAML::BeginSeq;
+		if constexpr (ComponentReflection<T>::Reflected)
+			return ComponentTraits<T>::Serializable && ComponentReflection<T>::SerializedName[0] != '\0';
+		else
+			return false;
+	}
 
-		auto& gos = scene->GetGameObjects();
-		for (size_t i = 0; i < gos.size(); i++)
-			SerializeGameObject(out, gos[i]);
+	template<class List>
+	struct ComponentOptionals;
 
-		out << YAML::EndSeq;
-		out << YAML::EndMap;
+	template<class... T>
+	struct ComponentOptionals<ComponentTypeList<T...>>
+	{
+		using Type = std::tuple<std::optional<T>...>;
+	};
+
+	// 从YAML里解析出来的一个GameObject的所有Component, 解析可以在任意线程进行, 最后在主线程统一insert到registry里
+	// Transform总是有的, IDComponent和NameComponent由ID和Name生成, 不使用Components里对应的项
+	struct GameObjectData
+	{
+		uint64_t ID = 0;
+		std::string Name;
+		ComponentOptionals<AllComponentTypes>::Type Components;
 
-		std::ofstream fout(savePath);
-		fout << out.c_str();
+		template<class T>
+		std::optional<T>& Get() { return std::get<std::optional<T>>(Components); }
+	};
+
+	static void ReadField(const FieldInfo& field, const YAML::Node& node, void* com)
+	{
+		switch (field.Type)
+		{
+		case FieldType::Bool:		{ bool v = node.as<bool>(); field.Set(com, &v); break; }
+		case FieldType::Int:
+		{
+			int v = node.as<int>();
+			if (IsValidFieldValue(field, &v))
+				field.Set(com, &v);
+			else
+				CORE_LOG_WARNING("Invalid value {0} for field {1}, the default value is kept", v, field.Name);
+			break;
+		}
+		case FieldType::Float:		{ float v = node.as<float>(); field.Set(com, &v); break; }
+		case FieldType::UInt64:		{ uint64_t v = node.as<uint64_t>(); field.Set(com, &v); break; }
+		case FieldType::Vec2:		{ glm::vec2 v = node.as<glm::vec2>(); field.Set(com, &v); break; }
+		case FieldType::Vec3:		{ glm::vec3 v = node.as<glm::vec3>(); field.Set(com, &v); break; }
+		case FieldType::Vec4:		{ glm::vec4 v = node.as<glm::vec4>(); field.Set(com, &v); break; }
+		case FieldType::String:		{ std::string v = node.as<std::string>(); field.Set(com, &v); break; }
+		case FieldType::Vec2List:
+		{
+			std::vector<glm::vec2> v;
+			for (auto item : node)
+				v.push_back(item.as<glm::vec2>());
+			field.Set(com, &v);
+			break;
+		}
+		}
 	}
 
-	bool SceneSerializer::Deserialize(std::shared_ptr<Scene> scene, const char* filepath)
+	static void WriteField(YAML::Emitter& out, const FieldInfo& field, const void* com)
 	{
-		std::ifstream stream(filepath);
-		std::stringstream strStream;
-		strStream << stream.rdbuf();
+		out << YAML::Key << field.Name << YAML::Value;
+		switch (field.Type)
+		{
+		case FieldType::Bool:		{ bool v; field.Get(com, &v); out << v; break; }
+		case FieldType::Int:		{ int v; field.Get(com, &v); out << v; break; }
+		case FieldType::Float:		{ float v; field.Get(com, &v); out << v; break; }
+		case FieldType::UInt64:		{ uint64_t v; field.Get(com, &v); out << v; break; }
+		case FieldType::Vec2:		{ glm::vec2 v; field.Get(com, &v); out << v; break; }
+		case FieldType::Vec3:		{ glm::vec3 v; field.Get(com, &v); out << v; break; }
+		case FieldType::Vec4:		{ glm::vec4 v; field.Get(com, &v); out << v; break; }
+		case FieldType::String:		{ std::string v; field.Get(com, &v); out << v; break; }
+		case FieldType::Vec2List:
+		{
+			std::vector<glm::vec2> v;
+			field.Get(com, &v);
+			out << YAML::BeginSeq;
+			for (const glm::vec2& item : v)
+				out << item;
+			out << YAML::EndSeq;
+			break;
+		}
+		}
+	}
 
-		// YAML里的数据也是用Tree形式读取得到的
-		// data的[]重载会创建并返回一个Node对象, 所以这里不需要用Node&
-		YAML::Node data = YAML::Load(strStream.str());
+	// 遍历一次YAML的map, 每个key在字段表里查找对应的字段; 文件里没有的字段保持默认值, 不认识的key直接忽略
+	template<class T>
+	static void ReadComponent(const YAML::Node& node, T& com)
+	{
+		for (auto it = node.begin(); it != node.end(); ++it)
+		{
+			const FieldInfo* field = FindField<T>(it->first.Scalar().c_str());
+			if (field)
+				ReadField(*field, it->second, &com);
+		}
+	}
 
-		// 找到data里对应的Scene的数据
-		if (!data["Scene"])
-			return false;
+	// GameObject这一层的每个key对应的处理函数, 由AllComponentTypes在第一次使用时生成
+	struct YamlSection
+	{
+		const char* Name;
+		void(*Read)(const YAML::Node& node, GameObjectData& data);
+	};
 
-		// TODO: 准确的说, 这部分内容不应该在Deserialize时调用, 而应该在PlayMode下调用
-		Physics2D::Init();
+	static const std::vector<YamlSection>& GetYamlSections()
+	{
+		static std::vector<YamlSection> s_Sections = []()
+		{
+			std::vector<YamlSection> res;
+			ForEachComponentType(AllComponentTypes{}, [&res](auto tag)
+				{
+					using T = typename decltype(tag)::Type;
+					if constexpr (IsYamlSection<T>())
+					{
+						res.push_back({ ComponentReflection<T>::SerializedName, [](const YAML::Node& node, GameObjectData& data)
+							{
+								std::optional<T>& com = data.Get<T>();
+								if (!com)
+									com.emplace();
+								ReadComponent(node, *com);
+							} });
+					}
+				});
+			return res;
+		}();
+
+		return s_Sections;
+	}
 
-		std::string sceneName = data["Scene"].as<std::string>();
+	static void ParseGameObject(const YAML::Node& entity, GameObjectData& res)
+	{
+		// Entities always have transforms
+		res.Get<Transform>().emplace();
 
-		YAML::Node entities = data["GameObjects"];
-		if (entities)
+		bool hasUUID = false;
+		const std::vector<YamlSection>& sections = GetYamlSections();
+		for (auto it = entity.begin(); it != entity.end(); ++it)
 		{
-			for (auto entity : entities)
+			const std::string& key = it->first.Scalar();
+			if (key == "Name")
+				res.Name = it->second.as<std::string>();
+			else if (key == "UUID")
+			{
+				res.ID = it->second.as<uint64_t>();
+				hasUUID = true;
+			}
+			else
 			{
-				std::string name = entity["Name"].as<std::string>();
+				for (const YamlSection& section : sections)
+				{
+					if (key == section.Name)
+					{
+						section.Read(it->second, res);
+						break;
+					}
+				}
+			}
+		}
+
+		// 旧的Scene文件里没有UUID, 重新生成一个
+		if (!hasUUID)
+			res.ID = UUID();
+
+		// 创建b2Body用的位置和角度来自Transform
+		if (std::optional<Rigidbody2D>& rb = res.Get<Rigidbody2D>())
+		{
+			const Transform& tc = *res.Get<Transform>();
+			rb->SetPose({ tc.Translation.x, tc.Translation.y }, tc.Rotation.z);
+		}
+	}
+
+	// 只有insert这一步需要碰registry, 每种Component整段写入
+	template<class T>
+	static void InsertComponents(entt::registry& registry, const std::vector<entt::entity>& entities, GameObjectData* data)
+	{
+		std::vector<entt::entity> subset;
+		std::vector<T> components;
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			std::optional<T>& com = data[i].Get<T>();
+			if (com)
+			{
+				subset.push_back(entities[i]);
+				components.push_back(std::move(*com));
+			}
+		}
+
+		registry.insert<T>(subset.begin(), subset.end(), components.begin());
+	}
+
+	std::vector<entt::entity> SceneSerializer::InsertGameObjects(std::shared_ptr<Scene> scene, GameObjectData* data, size_t count)
+	{
+		entt::registry& registry = scene->GetRegistry();
+		std::vector<entt::entity> entities(count);
+		registry.create(entities.begin(), entities.end());
+
+		std::vector<IDComponent> ids;
+		std::vector<NameComponent> names;
+		ids.reserve(count);
+		names.reserve(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			ids.emplace_back(data[i].ID);
+			names.emplace_back(std::move(data[i].Name));
+		}
 
-				// TODO, 这里的uuid需要赋值给deserializedEntity, 但是底层register又会Create一个id
-				uint64_t instanceId = entity["InstanceID"].as<uint32_t>();
-				auto uuidEnt = entity["UUID"];
-				
+		registry.insert<IDComponent>(entities.begin(), entities.end(), ids.begin());
+		registry.insert<NameComponent>(entities.begin(), entities.end(), names.begin());
 
-				GameObject deserializedEntity;
-				
-				if(uuidEnt)
+		ForEachComponentType(AllComponentTypes{}, [&registry, &entities, data](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				if constexpr (IsYamlSection<T>())
+					InsertComponents<T>(registry, entities, data);
+			});
+
+		scene->AddToHierarchy(entities);
+		return entities;
+	}
+
+	static void IndentLines(const char* text, std::string& out)
+	{
+		while (*text)
+		{
+			const char* end = strchr(text, '\n');
+			size_t len = end ? (size_t)(end - text) + 1 : strlen(text);
+			out.append("  ");
+			out.append(text, len);
+			text += len;
+		}
+
+		if (!out.empty() && out.back() != '\n')
+			out.push_back('\n');
+	}
+
+	// 每段GameObject用各自的Emitter并行写出, 每段GameObject数量为0时按线程数自动切分
+	static size_t GetBatchSize(size_t count, bool parallel)
+	{
+		if (!parallel)
+			return std::max<size_t>(1, count);
+
+		size_t threads = (size_t)JobSystem::GetWorkerCount() + 1;
+		return std::max<size_t>(16, count / (threads * 4));
+	}
+
+	void SceneSerializer::Serialize(std::shared_ptr<Scene> scene, const char* savePath, bool parallel)
+	{
+		auto& gos = scene->GetGameObjects();
+
+		// 非const的registry在访问不存在的pool时会创建它, 先在主线程把所有pool都创建好, 之后多个线程只读
+		entt::registry& registry = scene->GetRegistry();
+		ForEachComponentType(AllComponentTypes{}, [&registry](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				registry.storage<T>();
+			});
+
+		// 每段写成一个独立的YAML序列, 每行缩进两格以后按顺序拼接, 与一个Emitter写出来的结果相同
+		size_t batchSize = GetBatchSize(gos.size(), parallel);
+		std::vector<std::string> chunks((gos.size() + batchSize - 1) / batchSize);
+		JobSystem::ParallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t c = begin; c < end; c++)
 				{
-					uint64_t uuid = uuidEnt.as<uint64_t>();
-					deserializedEntity = scene->CreateGameObjectInSceneWithUUID(scene, uuid, name);
+					YAML::Emitter out;
+					out << YAML::BeginSeq;
+					for (size_t i = c * batchSize; i < std::min<size_t>(gos.size(), (c + 1) * batchSize); i++)
+						SerializeGameObject(out, gos[i]);
+					out << YAML::EndSeq;
+
+					IndentLines(out.c_str(), chunks[c]);
 				}
-				else
-					deserializedEntity = scene->CreateGameObjectInScene(scene, name);
-						
+			}, "SerializeScene");
+
+		// 完整保存以后, 之前IncrementalSceneSaver追加的增量都已经包含在内了, 替换完基础文件再删除它们
+		std::string tempPath = std::string(savePath) + ".tmp";
+		{
+			std::ofstream fout(tempPath);
+			fout << "Scene: Untitled\nGeneration: " << GetLatestDeltaGeneration(savePath) << "\n";
+			fout << (gos.empty() ? "GameObjects: []\n" : "GameObjects:\n");
+			for (const std::string& chunk : chunks)
+				fout << chunk;
+		}
+
+		ReplaceBaseFile(tempPath, savePath);
+	}
+
+	static size_t GetIndentation(const std::string& text, size_t lineBegin)
+	{
+		size_t i = lineBegin;
+		while (i < text.size() && text[i] == ' ')
+			i++;
+		return i - lineBegin;
+	}
 
-				auto transformComponent = entity["TransformComponent"];
-				if (transformComponent)
+	// 空行和注释行不影响YAML的结构
+	static bool IsBlankLine(const std::string& text, size_t lineBegin, size_t lineEnd)
+	{
+		size_t i = lineBegin + GetIndentation(text, lineBegin);
+		return i >= lineEnd || text[i] == '\n' || text[i] == '\r' || text[i] == '#';
+	}
+
+	static bool IsSequenceItem(const std::string& text, size_t pos)
+	{
+		return text.compare(pos, 1, "-") == 0 && (pos + 1 == text.size() || text[pos + 1] == ' ' || text[pos + 1] == '\n' || text[pos + 1] == '\r');
+	}
+
+	// 把顶层GameObjects这个block序列按元素切开, 返回每个元素在text里的起始位置, 最后一个位置是序列的结尾
+	// 其余部分(Scene的名字等)拼到header里; 不是block序列(比如写成了flow的形式)时返回false
+	static bool SplitGameObjects(const std::string& text, std::vector<size_t>& items, std::string& header)
+	{
+		size_t keyLine = std::string::npos;
+		for (size_t pos = 0; pos < text.size();)
+		{
+			size_t end = text.find('\n', pos);
+			end = end == std::string::npos ? text.size() : end + 1;
+			if (text.compare(pos, 12, "GameObjects:") == 0)
+			{
+				keyLine = pos;
+				if (!IsBlankLine(text, pos + 12, end))
+					return false;
+				header.append(text, 0, pos);
+				pos = end;
+
+				// 序列元素的缩进由第一个元素决定, 之后缩进相同并以'-'开头的行是下一个元素, 缩进更小的非空行是序列的结尾
+				size_t indent = std::string::npos;
+				for (; pos < text.size(); pos = end)
 				{
-					// Entities always have transforms
-					Transform& tc = deserializedEntity.GetComponent<Transform>();
-					tc.Translation = transformComponent["Translation"].as<glm::vec3>();
-					tc.Rotation = transformComponent["Rotation"].as<glm::vec3>();
-					tc.Scale = transformComponent["Scale"].as<glm::vec3>();
+					end = text.find('\n', pos);
+					end = end == std::string::npos ? text.size() : end + 1;
+					if (IsBlankLine(text, pos, end))
+						continue;
+
+					size_t lineIndent = GetIndentation(text, pos);
+					if (indent == std::string::npos)
+					{
+						if (!IsSequenceItem(text, pos + lineIndent))
+							return false;
+						indent = lineIndent;
+					}
+
+					if (lineIndent < indent || (lineIndent == indent && !IsSequenceItem(text, pos + lineIndent)))
+						break;
+
+					if (lineIndent == indent)
+						items.push_back(pos);
 				}
 
-				auto cameraComponent = entity["CameraComponent"];
-				if (cameraComponent)
-				{
-					auto& cc = deserializedEntity.AddComponent<CameraComponent>();
+				items.push_back(pos);
+				header.append(text, pos, std::string::npos);
+				break;
+			}
+			pos = end;
+		}
+
+		return keyLine != std::string::npos;
+	}
 
-					// TODO: 这些as全应该像radio一样做check
-					cc.SetProjectionType((CameraComponent::ProjectionType)cameraComponent["ProjectionType"].as<int>());
+	bool SceneSerializer::Deserialize(std::shared_ptr<Scene> scene, const char* filepath, bool parallel)
+	{
+		std::vector<GameObjectData> data;
+		if (!ParseGameObjects(filepath, data, parallel))
+			return false;
 
-					cc.SetPerspectiveVerticalFOV(cameraComponent["PerspectiveFOV"].as<float>());
-					cc.SetPerspectiveNearClip(cameraComponent["PerspectiveNear"].as<float>());
-					cc.SetPerspectiveFarClip(cameraComponent["PerspectiveFar"].as<float>());
+		InsertGameObjects(scene, data.data(), data.size());
+		return true;
+	}
 
-					cc.SetOrthographicSize(cameraComponent["OrthographicSize"].as<float>());
-					cc.SetOrthographicNearClip(cameraComponent["OrthographicNear"].as<float>());
-					cc.SetOrthographicFarClip(cameraComponent["OrthographicFar"].as<float>());
+	bool SceneSerializer::ParseGameObjects(const char* filepath, std::vector<GameObjectData>& data, bool parallel)
+	{
+		std::ifstream stream(filepath);
+		std::stringstream strStream;
+		strStream << stream.rdbuf();
+		std::string text = strStream.str();
 
-					//cc.Primary = cameraComponent["Primary"].as<bool>();
-					bool& radio = cc.GetFixedAspectRatio();
-					auto node = cameraComponent["FixedAspectRatio"];
-					if(node)
-						radio = node.as<bool>();
-				}
+		std::vector<size_t> items;
+		std::string header;
 
-				auto spriteRendererComponent = entity["SpriteRendererComponent"];
-				if (spriteRendererComponent)
+		if (parallel && SplitGameObjects(text, items, header))
+		{
+			// 找到data里对应的Scene的数据
+			YAML::Node headerNode = YAML::Load(header);
+			if (!headerNode["Scene"])
+				return false;
+
+			// 每段文本单独YAML::Load, 解析和转换成Component数据都在各自的线程里, 互不共享Node
+			size_t count = items.size() - 1;
+			size_t batchSize = GetBatchSize(count, parallel);
+			std::atomic<bool> failed{ false };
+			data.resize(count);
+			JobSystem::ParallelFor((count + batchSize - 1) / batchSize, 1, [&](size_t begin, size_t end)
 				{
-					auto& src = deserializedEntity.AddComponent<SpriteRenderer>();
-					glm::vec4& col = src.GetTintColor();
+					for (size_t c = begin; c < end; c++)
+					{
+						size_t first = c * batchSize;
+						size_t last = std::min<size_t>(count, first + batchSize);
+						try
+						{
+							YAML::Node entities = YAML::Load(text.substr(items[first], items[last] - items[first]));
+							if (!entities.IsSequence() || entities.size() != last - first)
+							{
+								failed = true;
+								return;
+							}
+
+							for (size_t i = first; i < last; i++)
+								ParseGameObject(entities[i - first], data[i]);
+						}
+						catch (const YAML::Exception&)
+						{
+							failed = true;
+						}
+					}
+				}, "DeserializeScene");
+
+			if (failed)
+				return false;
+		}
+		else
+		{
+			// YAML里的数据也是用Tree形式读取得到的
+			// data的[]重载会创建并返回一个Node对象, 所以这里不需要用Node&
+			YAML::Node root = YAML::Load(text);
 
-					auto node = spriteRendererComponent["Color"];
-					if (node)
-						col = node.as<glm::vec4>();
-				}
+			// 找到data里对应的Scene的数据
+			if (!root["Scene"])
+				return false;
 
-				auto rigidbody2DComponent = entity["Rigidbody2DComponent"];
-				if (rigidbody2DComponent)
-				{
-					// TODO: ASSERT
-					Transform& tc = deserializedEntity.GetComponent<Transform>();
-					tc.Translation = transformComponent["Translation"].as<glm::vec3>();
-					tc.Rotation = transformComponent["Rotation"].as<glm::vec3>();
-
-					auto& src = deserializedEntity.AddComponent<Rigidbody2D>(tc.Translation.x, tc.Translation.y, tc.Rotation.z);
-					Rigidbody2DType type = src.GetType();
-					auto node = rigidbody2DComponent["Type"];
-					if(node)
-						src.SetType((Rigidbody2DType)node.as<int>());
-
-					glm::vec2& extents = src.GetExtents();
-					auto extentsNode = rigidbody2DComponent["Extents"];
-					if (extentsNode)
-						src.SetExtents(extentsNode.as<glm::vec2>());
-				}
+			YAML::Node entities = root["GameObjects"];
+			if (entities)
+			{
+				data.resize(entities.size());
+				for (size_t i = 0; i < entities.size(); i++)
+					ParseGameObject(entities[i], data[i]);
 			}
 		}
 
 		return true;
 	}
 
-	void SceneSerializer::SerializeGameObject(YAML::Emitter& out, const GameObject& go)
+	// 异步加载在两次Merge之间共享的状态, worker线程上的解析Job只写Data和ParseSucceeded, 完成以后才由主线程读取
+	struct AsyncSceneLoad
 	{
-		// Map代表的映射关系pair
-		out << YAML::BeginMap;
-		out << YAML::Key << "Name" << YAML::Value << go.ToString();
-		out << YAML::Key << "InstanceID" << YAML::Value << go.GetInstanceId();
-		out << YAML::Key << "UUID" << YAML::Value << go.GetUUID();
+		std::shared_ptr<Scene> TargetScene;
+		std::string Path;
+		float FrameBudgetMs;
+		std::function<void(float)> OnProgress;
+		std::function<void(bool)> OnComplete;
 
-		if (go.HasComponent<Transform>())
+		bool Binary = false;
+		JobCounter ParseCounter;
+		bool ParseSucceeded = false;
+
+		std::vector<GameObjectData> Data;
+		size_t Merged = 0;
+	};
+
+	// 只在主线程访问
+	static std::vector<std::shared_ptr<AsyncSceneLoad>> s_PendingLoads;
+
+	void SceneSerializer::DeserializeAsync(std::shared_ptr<Scene> scene, const std::string& path, float frameBudgetMs,
+		const std::function<void(float)>& onProgress, const std::function<void(bool)>& onComplete)
+	{
+		std::shared_ptr<AsyncSceneLoad> load = std::make_shared<AsyncSceneLoad>();
+		load->TargetScene = scene;
+		load->Path = path;
+		load->FrameBudgetMs = frameBudgetMs;
+		load->OnProgress = onProgress;
+		load->OnComplete = onComplete;
+		s_PendingLoads.push_back(load);
+
+		// 二进制格式只是映射文件再整段insert, 在下一次PumpAsyncLoads里直接完成
+		if (IsBinaryScenePath(path))
 		{
-			out << YAML::Key << "TransformComponent";
-			out << YAML::BeginMap;
+			load->Binary = true;
+			return;
+		}
 
-			auto& tc = go.GetComponent<Transform>();
-			out << YAML::Key << "Translation" << YAML::Value << tc.Translation;
-			out << YAML::Key << "Rotation" << YAML::Value << tc.Rotation;
-			out << YAML::Key << "Scale" << YAML::Value << tc.Scale;
+#ifdef HZ_DIST
+		// 没有提交解析Job, 下一次PumpAsyncLoads直接以失败结束
+		CORE_LOG_ERROR("Only cooked binary scenes can be loaded in distribution builds: {0}", path);
+#else
+		// 读文件和解析都在worker线程里, 结果只是一组与registry无关的GameObjectData
+		JobSystem::Submit([load]()
+			{
+				try
+				{
+					load->ParseSucceeded = ParseGameObjects(load->Path.c_str(), load->Data, true);
+				}
+				catch (const YAML::Exception& e)
+				{
+					CORE_LOG_ERROR("Failed to parse scene {0}: {1}", load->Path, e.what());
+				}
+			}, &load->ParseCounter, "ParseScene");
+#endif
+	}
+
+	// 由主循环每帧在所有System之外调用一次, 不通过SubmitToMainThread提交:
+	// 主线程上的JobSystem::Wait也会执行主线程Job, 合并就可能在Serialize、SystemScheduler::Run等函数的中途插进来
+	void SceneSerializer::PumpAsyncLoads()
+	{
+		if (s_PendingLoads.empty())
+			return;
+
+		// 先把完成的加载取出来再回调, 回调里可能会开始新的加载
+		std::vector<std::pair<std::shared_ptr<AsyncSceneLoad>, bool>> finished;
+		for (size_t i = 0; i < s_PendingLoads.size(); )
+		{
+			std::shared_ptr<AsyncSceneLoad> load = s_PendingLoads[i];
+			bool done = false, success = false;
+			if (load->Binary)
+			{
+				success = BinarySceneSerializer::Deserialize(load->TargetScene, load->Path.c_str());
+				if (load->OnProgress)
+					load->OnProgress(1.0f);
+				done = true;
+			}
+			else if (load->ParseCounter.IsDone())
+			{
+				if (load->ParseSucceeded)
+					done = MergeAsyncLoad(*load, success);
+				else
+					done = true;
+			}
 
-			out << YAML::EndMap;
+			if (done)
+			{
+				finished.emplace_back(load, success);
+				s_PendingLoads.erase(s_PendingLoads.begin() + i);
+			}
+			else
+				i++;
+		}
+
+		for (auto& [load, success] : finished)
+		{
+			if (load->OnComplete)
+				load->OnComplete(success);
 		}
+	}
+
+	bool SceneSerializer::HasPendingAsyncLoads()
+	{
+		return !s_PendingLoads.empty();
+	}
 
-		if (go.HasComponent<CameraComponent>())
+	// 每帧执行一次, 按批insert到Scene里, 超出时间预算就把剩下的留到下一帧; 全部合并完返回true
+	bool SceneSerializer::MergeAsyncLoad(AsyncSceneLoad& load, bool& outSuccess)
+	{
+		const size_t batchSize = 256;
+		auto start = std::chrono::steady_clock::now();
+		while (load.Merged < load.Data.size())
 		{
-			out << YAML::Key << "CameraComponent";
-			out << YAML::BeginMap; // CameraComponent
+			size_t count = std::min<size_t>(batchSize, load.Data.size() - load.Merged);
+			InsertGameObjects(load.TargetScene, load.Data.data() + load.Merged, count);
+			load.Merged += count;
+
+			float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (elapsedMs >= load.FrameBudgetMs)
+				break;
+		}
+
+		if (load.OnProgress)
+			load.OnProgress(load.Data.empty() ? 1.0f : (float)load.Merged / load.Data.size());
+
+		if (load.Merged < load.Data.size())
+			return false;
 
-			auto& camera = go.GetComponent<CameraComponent>();
+		outSuccess = ApplyDelta(load.TargetScene, load.Path.c_str());
+		load.Data.clear();
+		return true;
+	}
 
-			out << YAML::Key << "ProjectionType" << YAML::Value << (int)camera.GetProjectionType();
-			out << YAML::Key << "PerspectiveFOV" << YAML::Value << camera.GetPerspectiveVerticalFOV();
-			out << YAML::Key << "PerspectiveNear" << YAML::Value << camera.GetPerspectiveNearClip();
-			out << YAML::Key << "PerspectiveFar" << YAML::Value << camera.GetPerspectiveFarClip();
-			out << YAML::Key << "OrthographicSize" << YAML::Value << camera.GetOrthographicSize();
-			out << YAML::Key << "OrthographicNear" << YAML::Value << camera.GetOrthographicNearClip();
-			out << YAML::Key << "OrthographicFar" << YAML::Value << camera.GetOrthographicFarClip();
+	bool SceneSerializer::IsBinaryScenePath(const std::string& path)
+	{
+		return std::filesystem::path(path).extension() == ".hscene";
+	}
+
+	bool SceneSerializer::Load(std::shared_ptr<Scene> scene, const char* path)
+	{
+		if (IsBinaryScenePath(path))
+			return BinarySceneSerializer::Deserialize(scene, path);
+
+#ifdef HZ_DIST
+		CORE_LOG_ERROR("Only cooked binary scenes can be loaded in distribution builds: {0}", path);
+		return false;
+#else
+		return Deserialize(scene, path) && ApplyDelta(scene, path);
+#endif
+	}
 
-			//out << YAML::Key << "Primary" << YAML::Value << cameraComponent.Primary;
-			out << YAML::Key << "FixedAspectRatio" << YAML::Value << camera.GetFixedAspectRatio();
+	std::string SceneSerializer::GetDeltaPath(const std::string& path)
+	{
+		return path + ".delta";
+	}
 
-			out << YAML::EndMap; // CameraComponent
+	uint64_t SceneSerializer::GetLatestDeltaGeneration(const std::string& path)
+	{
+		// 每个增量文档开头顶格的"Generation: N", GameObject的内容都有缩进, 不会混淆
+		std::ifstream stream(GetDeltaPath(path));
+		std::string line;
+		uint64_t latest = 0;
+		while (std::getline(stream, line))
+		{
+			if (line.compare(0, 12, "Generation: ") == 0)
+				latest = std::max<uint64_t>(latest, std::strtoull(line.c_str() + 12, nullptr, 10));
 		}
 
-		if (go.HasComponent<SpriteRenderer>())
+		return latest;
+	}
+
+	bool SceneSerializer::ReplaceBaseFile(const std::string& tempPath, const std::string& path)
+	{
+		std::error_code ec;
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec)
 		{
-			out << YAML::Key << "SpriteRendererComponent";
-			out << YAML::BeginMap;
+			CORE_LOG_ERROR("Failed to replace scene file {0}: {1}", path, ec.message());
+			return false;
+		}
+
+		std::filesystem::remove(GetDeltaPath(path), ec);
+		return true;
+	}
 
-			auto& spriteRendererComponent = go.GetComponent<SpriteRenderer>();
-			out << YAML::Key << "Color" << YAML::Value << spriteRendererComponent.GetTintColor();
+	void SceneSerializer::EmitGameObject(const GameObject& go, std::string& out)
+	{
+		YAML::Emitter emitter;
+		emitter << YAML::BeginSeq;
+		SerializeGameObject(emitter, go);
+		emitter << YAML::EndSeq;
+		IndentLines(emitter.c_str(), out);
+	}
 
-			out << YAML::EndMap;
+	// Scene文件开头GameObjects之前的部分, 由IncrementalSceneSaver写入, 旧的文件里没有, 视为0
+	static uint64_t ReadBaseGeneration(const char* path)
+	{
+		std::ifstream stream(path);
+		std::string header, line;
+		while (std::getline(stream, line) && line.compare(0, 12, "GameObjects:") != 0)
+			header += line + "\n";
+
+		YAML::Node node = YAML::Load(header);
+		if (auto generation = node["Generation"])
+			return generation.as<uint64_t>();
+		return 0;
+	}
+
+	template<class T>
+	static void ReplaceOrRemove(entt::registry& registry, entt::entity entity, std::optional<T>& com)
+	{
+		if (com)
+			registry.emplace_or_replace<T>(entity, std::move(*com));
+		else
+			registry.remove<T>(entity);
+	}
+
+	// delta是追加写入的, 保存到一半退出时最后一个文档可能不完整
+	// 每个文档单独解析, 遇到解析失败或者缺少最后一项Removed的文档时, 丢弃它和之后的内容, 前面完整的增量照常应用
+	static std::vector<YAML::Node> LoadDeltaDocuments(const std::string& deltaPath)
+	{
+		std::vector<std::string> texts;
+		std::ifstream stream(deltaPath);
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			if (line == "---" || texts.empty())
+				texts.emplace_back();
+			texts.back() += line + "\n";
 		}
 
-		if (go.HasComponent<Rigidbody2D>())
+		std::vector<YAML::Node> docs;
+		for (const std::string& text : texts)
 		{
-			out << YAML::Key << "Rigidbody2DComponent";
-			out << YAML::BeginMap;
-			auto& rigidbody2DComponent = go.GetComponent<Rigidbody2D>();
-			out << YAML::Key << "Type" << YAML::Value << (int)rigidbody2DComponent.GetType();
-			out << YAML::Key << "Extents" << YAML::Value << rigidbody2DComponent.GetExtents();
-			out << YAML::EndMap;
+			try
+			{
+				YAML::Node doc = YAML::Load(text);
+				if (!doc.IsMap() || !doc["Removed"])
+				{
+					CORE_LOG_WARNING("Scene delta {0} ends with an incomplete entry, it is ignored", deltaPath);
+					break;
+				}
+				docs.push_back(doc);
+			}
+			catch (const YAML::Exception& e)
+			{
+				CORE_LOG_WARNING("Scene delta {0} ends with an unreadable entry, it is ignored: {1}", deltaPath, e.what());
+				break;
+			}
 		}
 
+		return docs;
+	}
+
+	bool SceneSerializer::ApplyDelta(std::shared_ptr<Scene> scene, const char* path)
+	{
+		std::string deltaPath = GetDeltaPath(path);
+		if (!std::filesystem::exists(deltaPath))
+			return true;
+
+		uint64_t baseGeneration = ReadBaseGeneration(path);
+		std::vector<YAML::Node> docs = LoadDeltaDocuments(deltaPath);
+
+		entt::registry& registry = scene->GetRegistry();
+		std::unordered_map<uint64_t, entt::entity> uuidToEntity;
+		for (auto [entity, id] : registry.view<IDComponent>().each())
+			uuidToEntity[id.ID] = entity;
+
+		// 完整的文档里仍然可能有无法转换的值(比如手动改坏的文件), 不能让异常一直抛到主循环里
+		try
+		{
+			for (const YAML::Node& doc : docs)
+			{
+				// 后台压缩写出的基础文件已经包含了这些增量
+				if (!doc["Generation"] || doc["Generation"].as<uint64_t>() <= baseGeneration)
+					continue;
+
+				// 先删除再写入, 同一个UUID先被删除又被重新创建时结果也是对的
+				std::vector<entt::entity> removed;
+				if (auto removedNode = doc["Removed"])
+				{
+					for (auto uuidNode : removedNode)
+					{
+						auto it = uuidToEntity.find(uuidNode.as<uint64_t>());
+						if (it == uuidToEntity.end())
+							continue;
+
+						removed.push_back(it->second);
+						uuidToEntity.erase(it);
+					}
+				}
+				scene->DestroyGameObjects(removed);
+
+				std::vector<GameObjectData> created;
+				if (auto entities = doc["GameObjects"])
+				{
+					for (auto entityNode : entities)
+					{
+						GameObjectData data;
+						ParseGameObject(entityNode, data);
+
+						auto it = uuidToEntity.find(data.ID);
+						if (it == uuidToEntity.end())
+						{
+							created.push_back(std::move(data));
+							continue;
+						}
+
+						entt::entity entity = it->second;
+						registry.get<NameComponent>(entity).Name = std::move(data.Name);
+						ForEachComponentType(AllComponentTypes{}, [&registry, entity, &data](auto tag)
+							{
+								using T = typename decltype(tag)::Type;
+								if constexpr (IsYamlSection<T>())
+									ReplaceOrRemove(registry, entity, data.Get<T>());
+							});
+					}
+				}
+
+				std::vector<entt::entity> createdEntities = InsertGameObjects(scene, created.data(), created.size());
+				for (entt::entity entity : createdEntities)
+					uuidToEntity[registry.get<IDComponent>(entity).ID] = entity;
+			}
+		}
+		catch (const YAML::Exception& e)
+		{
+			CORE_LOG_ERROR("Failed to apply scene delta {0}: {1}", deltaPath, e.what());
+			return false;
+		}
+
+		return true;
+	}
+
+	void SceneSerializer::SerializeGameObject(YAML::Emitter& out, const GameObject& go)
+	{
+		// Map代表的映射关系pair
+		out << YAML::BeginMap;
+		out << YAML::Key << "Name" << YAML::Value << go.ToString();
+		out << YAML::Key << "InstanceID" << YAML::Value << go.GetInstanceId();
+		out << YAML::Key << "UUID" << YAML::Value << go.GetUUID();
+
+		// 每个Component的字段都来自它的字段表, 新的Component只需要添加ComponentReflection的特化
+		ForEachComponentType(AllComponentTypes{}, [&out, &go](auto tag)
+			{
+				using T = typename decltype(tag)::Type;
+				if constexpr (IsYamlSection<T>())
+				{
+					if (!go.HasComponent<T>())
+						return;
+
+					out << YAML::Key << ComponentReflection<T>::SerializedName;
+					out << YAML::BeginMap;
+					const T& com = go.GetComponent<T>();
+					for (const FieldInfo& field : ComponentReflection<T>::Fields)
+						WriteField(out, field, &com);
+					out << YAML::EndMap;
+				}
+			});
+
 		out << YAML::EndMap;
 	}
 
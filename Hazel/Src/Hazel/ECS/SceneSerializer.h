@@ -1,18 +1,54 @@
 #pragma once
 #include "yaml-cpp/yaml.h"
 #include "glm/glm.hpp"
+#include "entt.hpp"
+#include <functional>
 
 namespace Hazel
 {
 	class Scene;
 	class GameObject;
+	struct GameObjectData;
+	struct AsyncSceneLoad;
 	class SceneSerializer
 	{ 
 	public:	
-		static void Serialize(std::shared_ptr<Scene>, const char* path);
-		static bool Deserialize(std::shared_ptr<Scene> scene, const char* path);
+		// parallel为true时, GameObject被分成若干段, 在JobSystem里并行地写出和解析, 最后在主线程一次性insert到registry里
+		// 两种模式写出的文件完全相同
+		static void Serialize(std::shared_ptr<Scene>, const char* path, bool parallel = true);
+		static bool Deserialize(std::shared_ptr<Scene> scene, const char* path, bool parallel = true);
+		// 在worker线程里读文件、解析成与registry无关的Component数据, 然后由PumpAsyncLoads每帧合并一部分到scene里,
+		// 每帧花在合并上的时间不超过frameBudgetMs, 切换关卡时主循环不会卡住
+		// 每帧合并以后调用onProgress(0~1), 全部完成(包括delta)后调用onComplete, 两者都在主线程调用
+		// 后缀与Load相同: *.hscene按二进制格式加载, 发布版不接受YAML
+		static void DeserializeAsync(std::shared_ptr<Scene> scene, const std::string& path, float frameBudgetMs = 2.0f,
+			const std::function<void(float)>& onProgress = nullptr, const std::function<void(bool)>& onComplete = nullptr);
+		// 主循环每帧在主线程调用一次, 不能在Scene::Update、Serialize等访问scene的函数中途调用
+		static void PumpAsyncLoads();
+		static bool HasPendingAsyncLoads();
+		// 根据后缀选择格式: *.hscene是烘焙过的二进制格式(BinarySceneSerializer), 其他按YAML解析
+		// 发布版(HZ_DIST)只加载二进制格式, YAML需要先用BinarySceneSerializer::ConvertYamlToBinary烘焙
+		static bool Load(std::shared_ptr<Scene> scene, const char* path);
+		static bool IsBinaryScenePath(const std::string& path);
+
+		// IncrementalSceneSaver把改动追加到"<path>.delta"里, Load会在加载基础文件以后按顺序应用这些增量
+		// 完整的Serialize会删除对应的delta文件
+		static bool ApplyDelta(std::shared_ptr<Scene> scene, const char* path);
+		static std::string GetDeltaPath(const std::string& path);
+		// delta文件里最新的Generation, 没有delta时返回0
+		// 完整写出的基础文件使用不小于它的Generation, 替换完基础文件、还没删除delta时退出, Load也不会再应用这些旧的增量
+		static uint64_t GetLatestDeltaGeneration(const std::string& path);
+		// 完整的基础文件先写到tempPath, 再替换path, 最后才删除delta, 任何时候退出磁盘上都有完整的数据
+		static bool ReplaceBaseFile(const std::string& tempPath, const std::string& path);
+		// 把一个GameObject写成GameObjects序列里的一项(带缩进), 与Serialize写出的文本完全相同
+		static void EmitGameObject(const GameObject& go, std::string& out);
 		static void SerializeGameObject(YAML::Emitter& out, const GameObject&);
 		static GameObject DeserializeGameObject(YAML::Emitter& out);
+
+	private:
+		static bool ParseGameObjects(const char* path, std::vector<GameObjectData>& data, bool parallel);
+		static std::vector<entt::entity> InsertGameObjects(std::shared_ptr<Scene> scene, GameObjectData* data, size_t count);
+		static bool MergeAsyncLoad(AsyncSceneLoad& load, bool& outSuccess);
 	};
 }
 
@@ -0,0 +1,56 @@
+#pragma once
+#include "entt.hpp"
+#include "Components/ComponentRegistry.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace Hazel
+{
+	// Scene在某一时刻的完整拷贝, 由Scene::Snapshot创建, Scene::Restore还原
+	// 每个Component pool的拷贝都是不可变的, 用shared_ptr持有: 两次Snapshot之间没有被修改过的pool,
+	// 新的Snapshot直接共享上一次的拷贝(copy-on-write), Restore时这类pool也会被跳过
+	class SceneSnapshot
+	{
+		friend class Scene;
+	public:
+		struct ComponentPool
+		{
+			std::vector<entt::entity> Entities;// 与entt里packed数组的顺序相同
+			std::shared_ptr<void> Components;// std::vector<T>
+		};
+
+		size_t GetEntityCount() const { return m_Entities.size(); }
+
+	private:
+		// registry里的entity数组和free list, 还原后entity的id和version都与拍快照时相同
+		std::vector<entt::entity> m_Entities;
+		entt::entity m_Released = entt::null;
+
+		std::vector<entt::entity> m_Hierarchy;
+		std::array<std::shared_ptr<const ComponentPool>, AllComponentTypes::Count> m_Pools;
+	};
+
+	// 拷贝pool时对单个Component的额外处理, 默认什么都不做
+	// 需要特殊处理的Component(比如持有外部资源的)在这里特化
+	template<class T>
+	struct SnapshotPolicy
+	{
+		static constexpr bool HasHooks = false;
+		static void OnCapture(T& copy) {}
+		static void OnRelease(T& live) {}
+		static void OnRestore(T& live) {}
+	};
+
+	// b2Body属于物理世界, 不能随Component一起拷贝:
+	// 拍快照时只记录b2Body当前的位置和角度, 还原时先删掉旧的b2Body
+	// 如果物理正在运行, Scene::Restore会在所有pool还原以后, 根据记录的数据统一重新创建b2Body
+	template<>
+	struct SnapshotPolicy<Rigidbody2D>
+	{
+		static constexpr bool HasHooks = true;
+		static void OnCapture(Rigidbody2D& copy) { copy.DetachBody(); }
+		static void OnRelease(Rigidbody2D& live) { live.DestroyBody(); }
+		static void OnRestore(Rigidbody2D& live) {}
+	};
+}
@@ -0,0 +1,52 @@
+#include "hzpch.h"
+#include "SimulationRunner.h"
+#include "Scene.h"
+#include "Hazel/Core/JobSystem.h"
+
+namespace Hazel
+{
+	void SimulationRunner::AddScene(const std::shared_ptr<Scene>& scene)
+	{
+		if (std::find(m_Scenes.begin(), m_Scenes.end(), scene) != m_Scenes.end())
+			return;
+
+		// 与编辑器里点Play一样, 在Scene自己的物理世界里批量创建b2Body
+		scene->Begin();
+		m_Scenes.push_back(scene);
+	}
+
+	void SimulationRunner::RemoveScene(const std::shared_ptr<Scene>& scene)
+	{
+		auto it = std::find(m_Scenes.begin(), m_Scenes.end(), scene);
+		if (it == m_Scenes.end())
+			return;
+
+		// 销毁b2Body, Scene之后可以再被编辑或者重新加入
+		scene->Stop();
+		m_Scenes.erase(it);
+	}
+
+	void SimulationRunner::Clear()
+	{
+		for (const std::shared_ptr<Scene>& scene : m_Scenes)
+			scene->Stop();
+
+		m_Scenes.clear();
+	}
+
+	void SimulationRunner::Step(float deltaTime)
+	{
+		// 每个Scene一个Job, Scene内部的SystemScheduler还会继续把不冲突的System拆成更小的Job
+		JobSystem::ParallelFor(m_Scenes.size(), 1, [this, deltaTime](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					m_Scenes[i]->Update(deltaTime);
+			}, "Simulation Step");
+	}
+
+	void SimulationRunner::Run(uint32_t frameCnt, float deltaTime)
+	{
+		for (uint32_t i = 0; i < frameCnt; i++)
+			Step(deltaTime);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+namespace Hazel
+{
+	class Scene;
+
+	// 同时推进多个互相独立的Scene, 比如服务器上的批量模拟、AI训练时的大量并行环境
+	// 每个Scene有自己的registry和物理世界, 所以每个Scene的Update作为一个Job在JobSystem里并行执行
+	// 例外是b2World::Step: Box2D的全局统计变量不是原子的, 各个Scene的物理模拟这一步是串行的, 其余System照常并行
+	// 这些Scene都是headless的, Runner不会调用UpdateWorldMatrices等渲染相关的函数
+	class SimulationRunner
+	{
+	public:
+		// 加入时会调用Scene::Begin开始物理模拟, 移除时调用Scene::Stop结束模拟
+		void AddScene(const std::shared_ptr<Scene>& scene);
+		void RemoveScene(const std::shared_ptr<Scene>& scene);
+		void Clear();
+
+		size_t GetSceneCount() const { return m_Scenes.size(); }
+		const std::vector<std::shared_ptr<Scene>>& GetScenes() const { return m_Scenes; }
+
+		// 所有Scene各自Update一次deltaTime, 全部完成后才返回
+		void Step(float deltaTime);
+		// 连续Step frameCnt次, 每次都是deltaTime
+		void Run(uint32_t frameCnt, float deltaTime);
+
+	private:
+		std::vector<std::shared_ptr<Scene>> m_Scenes;
+	};
+}
@@ -0,0 +1,490 @@
+#include "hzpch.h"
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <limits>
+
+namespace Hazel
+{
+	SpatialIndex::SpatialIndex(float cellSize)
+		: m_CellSize(cellSize)
+	{
+	}
+
+	void SpatialIndex::SetCellSize(float cellSize)
+	{
+		if (cellSize <= 0.0f || cellSize == m_CellSize)
+			return;
+
+		m_CellSize = cellSize;
+
+		m_Cells.clear();
+		m_Oversized.clear();
+		m_BoundsMin = { 0, 0 };
+		m_BoundsMax = { -1, -1 };
+
+		for (uint32_t i = 0; i < m_Entries.size(); i++)
+		{
+			m_Entries[i].CellMin = ToCell(m_Entries[i].Min);
+			m_Entries[i].CellMax = ToCell(m_Entries[i].Max);
+			Link(i);
+		}
+	}
+
+	void SpatialIndex::Clear()
+	{
+		m_Entries.clear();
+		m_EntityToEntry.clear();
+		m_Cells.clear();
+		m_Oversized.clear();
+		m_BoundsMin = { 0, 0 };
+		m_BoundsMax = { -1, -1 };
+	}
+
+	void SpatialIndex::Update(entt::entity entity, const glm::vec2& min, const glm::vec2& max)
+	{
+		uint32_t id = entt::to_entity(entity);
+		if (id >= m_EntityToEntry.size())
+			m_EntityToEntry.resize(id + 1, INVALID_INDEX);
+
+		glm::ivec2 cellMin = ToCell(min);
+		glm::ivec2 cellMax = ToCell(max);
+
+		uint32_t index = m_EntityToEntry[id];
+		if (index != INVALID_INDEX && m_Entries[index].Entity == entity)
+		{
+			Entry& e = m_Entries[index];
+			if (e.Min == min && e.Max == max)
+				return;
+
+			e.Min = min;
+			e.Max = max;
+
+			// 大部分移动的物体还在原来的格子里, 不需要改动格子里的列表
+			if (e.CellMin == cellMin && e.CellMax == cellMax)
+				return;
+
+			Unlink(index);
+			e.CellMin = cellMin;
+			e.CellMax = cellMax;
+			Link(index);
+			return;
+		}
+
+		// entity的id被回收复用, 之前version的数据还在, 先删掉
+		if (index != INVALID_INDEX)
+			Remove(m_Entries[index].Entity);
+
+		Entry e;
+		e.Entity = entity;
+		e.Min = min;
+		e.Max = max;
+		e.CellMin = cellMin;
+		e.CellMax = cellMax;
+		e.Oversized = false;
+
+		index = (uint32_t)m_Entries.size();
+		m_Entries.push_back(e);
+		m_EntityToEntry[id] = index;
+		Link(index);
+	}
+
+	void SpatialIndex::Remove(entt::entity entity)
+	{
+		uint32_t id = entt::to_entity(entity);
+		if (id >= m_EntityToEntry.size())
+			return;
+
+		uint32_t index = m_EntityToEntry[id];
+		if (index == INVALID_INDEX || m_Entries[index].Entity != entity)
+			return;
+
+		// 把最后一个Entry挪到被删除的位置, 格子里记录的是下标, 所以它也要重新Link
+		uint32_t last = (uint32_t)m_Entries.size() - 1;
+		Unlink(index);
+		if (index != last)
+		{
+			Unlink(last);
+			m_Entries[index] = m_Entries[last];
+			m_EntityToEntry[entt::to_entity(m_Entries[index].Entity)] = index;
+			Link(index);
+		}
+
+		m_Entries.pop_back();
+		m_EntityToEntry[id] = INVALID_INDEX;
+	}
+
+	bool SpatialIndex::Contains(entt::entity entity) const
+	{
+		uint32_t id = entt::to_entity(entity);
+		if (id >= m_EntityToEntry.size())
+			return false;
+
+		uint32_t index = m_EntityToEntry[id];
+		return index != INVALID_INDEX && m_Entries[index].Entity == entity;
+	}
+
+	void SpatialIndex::QueryAABB(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& out) const
+	{
+		std::vector<uint32_t> indices;
+		Gather(ToCell(min), ToCell(max), indices);
+
+		for (uint32_t index : indices)
+		{
+			const Entry& e = m_Entries[index];
+			if (e.Min.x <= max.x && e.Max.x >= min.x && e.Min.y <= max.y && e.Max.y >= min.y)
+				out.push_back(e.Entity);
+		}
+	}
+
+	void SpatialIndex::QueryRadius(const glm::vec2& center, float radius, std::vector<entt::entity>& out) const
+	{
+		std::vector<uint32_t> indices;
+		Gather(ToCell(center - glm::vec2(radius)), ToCell(center + glm::vec2(radius)), indices);
+
+		float radius2 = radius * radius;
+		for (uint32_t index : indices)
+		{
+			if (DistanceSquared(m_Entries[index], center) <= radius2)
+				out.push_back(m_Entries[index].Entity);
+		}
+	}
+
+	void SpatialIndex::QueryPoint(const glm::vec2& point, std::vector<entt::entity>& out) const
+	{
+		QueryAABB(point, point, out);
+	}
+
+	bool SpatialIndex::Raycast(const glm::vec2& origin, const glm::vec2& direction, float maxDistance, RaycastHit& outHit) const
+	{
+		float length = glm::length(direction);
+		if (length == 0.0f || m_Entries.empty())
+			return false;
+
+		glm::vec2 dir = direction / length;
+		glm::vec2 invDir = { 1.0f / dir.x, 1.0f / dir.y };// 分量为0时是inf, slab测试里可以正确处理
+
+		float best = maxDistance;
+		uint32_t bestIndex = INVALID_INDEX;
+
+		auto test = [&](uint32_t index)
+		{
+			float t;
+			if (RayIntersects(m_Entries[index], origin, invDir, best, t) && (bestIndex == INVALID_INDEX || t < best))
+			{
+				best = t;
+				bestIndex = index;
+			}
+		};
+
+		for (uint32_t index : m_Oversized)
+			test(index);
+
+		// 先把射线裁剪到有物体的格子范围内, 再用DDA逐个格子前进
+		if (m_BoundsMin.x <= m_BoundsMax.x)
+		{
+			Entry bounds;
+			bounds.Min = glm::vec2(m_BoundsMin) * m_CellSize;
+			bounds.Max = glm::vec2(m_BoundsMax + glm::ivec2(1)) * m_CellSize;
+
+			float tEnter;
+			if (RayIntersects(bounds, origin, invDir, best, tEnter))
+			{
+				glm::vec2 start = origin + dir * tEnter;
+				glm::ivec2 cell = glm::clamp(ToCell(start), m_BoundsMin, m_BoundsMax);
+				glm::ivec2 step = { dir.x > 0 ? 1 : (dir.x < 0 ? -1 : 0), dir.y > 0 ? 1 : (dir.y < 0 ? -1 : 0) };
+
+				const float inf = std::numeric_limits<float>::infinity();
+				glm::vec2 tMax, tDelta;
+				for (int axis = 0; axis < 2; axis++)
+				{
+					if (step[axis] == 0)
+					{
+						tMax[axis] = inf;
+						tDelta[axis] = inf;
+						continue;
+					}
+
+					float boundary = (cell[axis] + (step[axis] > 0 ? 1 : 0)) * m_CellSize;
+					tMax[axis] = (boundary - origin[axis]) * invDir[axis];
+					tDelta[axis] = m_CellSize * std::abs(invDir[axis]);
+				}
+
+				while (cell.x >= m_BoundsMin.x && cell.x <= m_BoundsMax.x && cell.y >= m_BoundsMin.y && cell.y <= m_BoundsMax.y)
+				{
+					auto it = m_Cells.find(CellKey(cell.x, cell.y));
+					if (it != m_Cells.end())
+					{
+						for (uint32_t index : it->second)
+							test(index);
+					}
+
+					// 已经找到的交点在当前格子以内, 后面的格子不可能更近
+					float cellExit = std::min<float>(tMax.x, tMax.y);
+					if (cellExit > best)
+						break;
+
+					if (tMax.x < tMax.y)
+					{
+						cell.x += step.x;
+						tMax.x += tDelta.x;
+					}
+					else
+					{
+						cell.y += step.y;
+						tMax.y += tDelta.y;
+					}
+				}
+			}
+		}
+
+		if (bestIndex == INVALID_INDEX)
+			return false;
+
+		outHit.Entity = m_Entries[bestIndex].Entity;
+		outHit.Distance = best;
+		outHit.Point = origin + dir * best;
+		return true;
+	}
+
+	void SpatialIndex::QueryNearest(const glm::vec2& point, uint32_t k, std::vector<entt::entity>& out) const
+	{
+		if (k == 0 || m_Entries.empty())
+			return;
+
+		std::vector<std::pair<float, uint32_t>> candidates;
+		std::vector<bool> visited(m_Entries.size(), false);
+
+		auto visit = [&](uint32_t index)
+		{
+			if (visited[index])
+				return;
+
+			visited[index] = true;
+			candidates.push_back({ DistanceSquared(m_Entries[index], point), index });
+		};
+
+		for (uint32_t index : m_Oversized)
+			visit(index);
+
+		// 以point所在的格子为中心, 一圈一圈向外扩展
+		glm::ivec2 center = ToCell(point);
+		int maxRing = std::max<int>(std::max<int>(std::abs(center.x - m_BoundsMin.x), std::abs(center.x - m_BoundsMax.x)),
+			std::max<int>(std::abs(center.y - m_BoundsMin.y), std::abs(center.y - m_BoundsMax.y)));
+
+		// point离有物体的区域很远时, 一圈圈扩展会遍历大量空格子, 不如直接检查所有Entry
+		glm::ivec2 gap = glm::max(glm::max(m_BoundsMin - center, center - m_BoundsMax), glm::ivec2(0));
+		int startRing = std::max<int>(gap.x, gap.y);
+		if ((int64_t)startRing * 8 > (int64_t)m_Entries.size())
+		{
+			for (uint32_t i = 0; i < m_Entries.size(); i++)
+				visit(i);
+			maxRing = -1;
+		}
+
+		for (int ring = startRing; ring <= maxRing; ring++)
+		{
+			for (int y = center.y - ring; y <= center.y + ring; y++)
+			{
+				// 只遍历这一圈的边界, 内部的格子已经处理过了
+				int dx = (y == center.y - ring || y == center.y + ring) ? 1 : 2 * ring;
+				for (int x = center.x - ring; x <= center.x + ring; x += std::max<int>(dx, 1))
+				{
+					auto it = m_Cells.find(CellKey(x, y));
+					if (it == m_Cells.end())
+						continue;
+
+					for (uint32_t index : it->second)
+						visit(index);
+				}
+			}
+
+			// 还没访问到的Entry都在这一圈以外, 它们与point的距离至少为ring * cellSize
+			if (candidates.size() >= k)
+			{
+				std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+				float bound = ring * m_CellSize;
+				if (candidates[k - 1].first <= bound * bound)
+					break;
+			}
+		}
+
+		size_t cnt = std::min<size_t>(k, candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + cnt, candidates.end());
+		for (size_t i = 0; i < cnt; i++)
+			out.push_back(m_Entries[candidates[i].second].Entity);
+	}
+
+	glm::ivec2 SpatialIndex::ToCell(const glm::vec2& p) const
+	{
+		return { (int)std::floor(p.x / m_CellSize), (int)std::floor(p.y / m_CellSize) };
+	}
+
+	void SpatialIndex::Link(uint32_t index)
+	{
+		Entry& e = m_Entries[index];
+
+		if (m_BoundsMin.x > m_BoundsMax.x)
+		{
+			m_BoundsMin = e.CellMin;
+			m_BoundsMax = e.CellMax;
+		}
+		else
+		{
+			m_BoundsMin = glm::min(m_BoundsMin, e.CellMin);
+			m_BoundsMax = glm::max(m_BoundsMax, e.CellMax);
+		}
+
+		int64_t cellCnt = (int64_t)(e.CellMax.x - e.CellMin.x + 1) * (e.CellMax.y - e.CellMin.y + 1);
+		e.Oversized = cellCnt > MAX_CELLS_PER_ENTRY;
+		if (e.Oversized)
+		{
+			m_Oversized.push_back(index);
+			return;
+		}
+
+		for (int y = e.CellMin.y; y <= e.CellMax.y; y++)
+			for (int x = e.CellMin.x; x <= e.CellMax.x; x++)
+				m_Cells[CellKey(x, y)].push_back(index);
+	}
+
+	void SpatialIndex::Unlink(uint32_t index)
+	{
+		auto eraseFrom = [index](std::vector<uint32_t>& list)
+		{
+			auto it = std::find(list.begin(), list.end(), index);
+			if (it != list.end())
+			{
+				*it = list.back();
+				list.pop_back();
+			}
+		};
+
+		Entry& e = m_Entries[index];
+		if (e.Oversized)
+		{
+			eraseFrom(m_Oversized);
+			return;
+		}
+
+		for (int y = e.CellMin.y; y <= e.CellMax.y; y++)
+		{
+			for (int x = e.CellMin.x; x <= e.CellMax.x; x++)
+			{
+				auto it = m_Cells.find(CellKey(x, y));
+				if (it == m_Cells.end())
+					continue;
+
+				eraseFrom(it->second);
+				if (it->second.empty())
+					m_Cells.erase(it);
+			}
+		}
+	}
+
+	void SpatialIndex::Gather(const glm::ivec2& cellMin, const glm::ivec2& cellMax, std::vector<uint32_t>& indices) const
+	{
+		indices.insert(indices.end(), m_Oversized.begin(), m_Oversized.end());
+
+		if (m_BoundsMin.x <= m_BoundsMax.x)
+		{
+			glm::ivec2 lo = glm::max(cellMin, m_BoundsMin);
+			glm::ivec2 hi = glm::min(cellMax, m_BoundsMax);
+
+			if (lo.x <= hi.x && lo.y <= hi.y)
+			{
+				int64_t rangeCnt = (int64_t)(hi.x - lo.x + 1) * (hi.y - lo.y + 1);
+
+				// 查询范围比非空格子还多时, 直接遍历所有非空格子更快
+				if (rangeCnt > (int64_t)m_Cells.size())
+				{
+					for (auto& [key, list] : m_Cells)
+					{
+						int x = (int)(int32_t)(uint32_t)(key >> 32);
+						int y = (int)(int32_t)(uint32_t)(key & 0xFFFFFFFF);
+						if (x >= lo.x && x <= hi.x && y >= lo.y && y <= hi.y)
+							indices.insert(indices.end(), list.begin(), list.end());
+					}
+				}
+				else
+				{
+					for (int y = lo.y; y <= hi.y; y++)
+					{
+						for (int x = lo.x; x <= hi.x; x++)
+						{
+							auto it = m_Cells.find(CellKey(x, y));
+							if (it != m_Cells.end())
+								indices.insert(indices.end(), it->second.begin(), it->second.end());
+						}
+					}
+				}
+			}
+		}
+
+		// 跨多个格子的Entry会被收集多次
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+	}
+
+	float SpatialIndex::DistanceSquared(const Entry& e, const glm::vec2& p)
+	{
+		glm::vec2 closest = glm::clamp(p, e.Min, e.Max);
+		glm::vec2 d = p - closest;
+		return glm::dot(d, d);
+	}
+
+	bool SpatialIndex::RayIntersects(const Entry& e, const glm::vec2& origin, const glm::vec2& invDir, float maxDistance, float& outDistance)
+	{
+		// slab测试, 起点在AABB内部时距离为0
+		float tMin = 0.0f;
+		float tMax = maxDistance;
+		for (int axis = 0; axis < 2; axis++)
+		{
+			float t1 = (e.Min[axis] - origin[axis]) * invDir[axis];
+			float t2 = (e.Max[axis] - origin[axis]) * invDir[axis];
+
+			// 射线与这个轴平行, 且起点不在slab里, 此时t1、t2同号为inf或者是NaN
+			if (std::isnan(t1) || std::isnan(t2))
+			{
+				if (origin[axis] < e.Min[axis] || origin[axis] > e.Max[axis])
+					return false;
+				continue;
+			}
+
+			tMin = std::max<float>(tMin, std::min<float>(t1, t2));
+			tMax = std::min<float>(tMax, std::max<float>(t1, t2));
+		}
+
+		if (tMin > tMax)
+			return false;
+
+		outDistance = tMin;
+		return true;
+	}
+
+	void SpatialIndex::ComputeViewBounds(const glm::mat4& viewProjection, float zMin, float zMax, glm::vec2& outMin, glm::vec2& outMax)
+	{
+		glm::mat4 inv = glm::inverse(viewProjection);
+		for (int i = 0; i < 4; i++)
+		{
+			glm::vec2 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f);
+			glm::vec4 nearPoint = inv * glm::vec4(ndc, -1.0f, 1.0f);
+			glm::vec4 farPoint = inv * glm::vec4(ndc, 1.0f, 1.0f);
+			nearPoint /= nearPoint.w;
+			farPoint /= farPoint.w;
+
+			// 视锥的这条棱与z = zMin、z = zMax两个平面的交点, 这条棱夹在两个平面之间的部分在XY上的范围就在两点之间
+			// 平面在近裁剪面之前或者远裁剪面之后时取对应的端点
+			glm::vec3 dir = glm::vec3(farPoint - nearPoint);
+			for (float z : { zMin, zMax })
+			{
+				float t = std::abs(dir.z) > 1e-6f ? (z - nearPoint.z) / dir.z : 0.0f;
+				t = std::min<float>(1.0f, std::max<float>(0.0f, t));
+				glm::vec2 p = glm::vec2(nearPoint) + glm::vec2(dir) * t;
+
+				bool first = i == 0 && z == zMin;
+				outMin = first ? p : glm::min(outMin, p);
+				outMax = first ? p : glm::max(outMax, p);
+			}
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "entt.hpp"
+#include "glm/glm.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace Hazel
+{
+	// Scene里GameObject在XY平面上的均匀网格索引, 每个GameObject用一个AABB表示
+	// AABB跨越的每个格子里都会记录它, 跨越格子太多的大物体单独放在一个列表里, 每次查询都检查
+	// 渲染剔除(Scene::ExtractRenderProxies)、编辑器的拾取、脚本里的范围查询都使用这同一个结构, 由Scene::UpdateWorldMatrices每帧更新标记过移动的GameObject
+	class SpatialIndex
+	{
+	public:
+		struct RaycastHit
+		{
+			entt::entity Entity = entt::null;
+			float Distance = 0.0f;
+			glm::vec2 Point = { 0, 0 };
+		};
+
+		SpatialIndex(float cellSize = 4.0f);
+
+		// 修改格子大小会重建整个索引
+		void SetCellSize(float cellSize);
+		float GetCellSize() const { return m_CellSize; }
+
+		void Clear();
+
+		// 插入或者更新entity的AABB, AABB没变化时什么都不做, 覆盖的格子没变化时只更新AABB
+		void Update(entt::entity entity, const glm::vec2& min, const glm::vec2& max);
+		void Remove(entt::entity entity);
+
+		bool Contains(entt::entity entity) const;
+		size_t Size() const { return m_Entries.size(); }
+
+		// 以下查询都是只读的, 可以在多个线程里同时调用, 结果追加到out里, 不保证顺序
+		void QueryAABB(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& out) const;
+		void QueryRadius(const glm::vec2& center, float radius, std::vector<entt::entity>& out) const;
+		void QueryPoint(const glm::vec2& point, std::vector<entt::entity>& out) const;
+
+		// 返回沿射线方向最近的一个AABB, direction不需要归一化
+		bool Raycast(const glm::vec2& origin, const glm::vec2& direction, float maxDistance, RaycastHit& outHit) const;
+
+		// 距离point最近的k个entity(按到AABB的距离), 结果按距离从近到远排列
+		void QueryNearest(const glm::vec2& point, uint32_t k, std::vector<entt::entity>& out) const;
+
+		// 相机能看到的、z在[zMin, zMax]之间的部分在XY平面上的包围盒, 用来做QueryAABB的剔除范围
+		// 透视相机下z不为0的物体投影位置会偏移, 所以要传入物体实际的z范围, 只关心z = 0时zMin和zMax都传0
+		static void ComputeViewBounds(const glm::mat4& viewProjection, float zMin, float zMax, glm::vec2& outMin, glm::vec2& outMax);
+
+	private:
+		struct Entry
+		{
+			entt::entity Entity;
+			glm::vec2 Min, Max;
+			glm::ivec2 CellMin, CellMax;
+			bool Oversized;
+		};
+
+		static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+		static constexpr int MAX_CELLS_PER_ENTRY = 16;
+
+		glm::ivec2 ToCell(const glm::vec2& p) const;
+		static uint64_t CellKey(int x, int y) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+
+		void Link(uint32_t index);
+		void Unlink(uint32_t index);
+
+		// 遍历[cellMin, cellMax]范围内格子里的所有Entry(包括大物体列表), 结果是去重后的下标
+		void Gather(const glm::ivec2& cellMin, const glm::ivec2& cellMax, std::vector<uint32_t>& indices) const;
+
+		static float DistanceSquared(const Entry& e, const glm::vec2& p);
+		static bool RayIntersects(const Entry& e, const glm::vec2& origin, const glm::vec2& invDir, float maxDistance, float& outDistance);
+
+	private:
+		float m_CellSize;
+		std::vector<Entry> m_Entries;
+		std::vector<uint32_t> m_EntityToEntry;// 以entity的id(不含version)为下标
+		std::unordered_map<uint64_t, std::vector<uint32_t>> m_Cells;
+		std::vector<uint32_t> m_Oversized;
+
+		// 所有Entry覆盖的格子范围, 只增不减, 用来限制QueryNearest和Raycast的搜索范围
+		glm::ivec2 m_BoundsMin = { 0, 0 }, m_BoundsMax = { -1, -1 };
+	};
+}
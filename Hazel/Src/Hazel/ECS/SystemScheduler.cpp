@@ -0,0 +1,160 @@
+#include "hzpch.h"
+#include "SystemScheduler.h"
+#include "Scene.h"
+#include "Hazel/Core/JobSystem.h"
+#include <chrono>
+
+namespace Hazel
+{
+	static bool HasAny(const std::vector<entt::id_type>& a, const std::vector<entt::id_type>& b)
+	{
+		for (entt::id_type id : a)
+		{
+			if (std::find(b.begin(), b.end(), id) != b.end())
+				return true;
+		}
+
+		return false;
+	}
+
+	// 读读不冲突, 只要有一方写了另一方读或写的Component就冲突
+	bool SceneSystem::ConflictsWith(const SceneSystem& other) const
+	{
+		if (m_Exclusive || other.m_Exclusive)
+			return true;
+
+		return HasAny(m_Writes, other.m_Writes) || HasAny(m_Writes, other.m_Reads) || HasAny(m_Reads, other.m_Writes);
+	}
+
+	SceneSystem& SystemScheduler::AddSystem(const std::string& name, const SceneSystem::SystemFn& func)
+	{
+		std::unique_ptr<SceneSystem> system = std::make_unique<SceneSystem>();
+		system->m_Name = name;
+		system->m_Func = func;
+		m_Systems.push_back(std::move(system));
+		return *m_Systems.back();
+	}
+
+	void SystemScheduler::RemoveSystem(const std::string& name)
+	{
+		for (auto it = m_Systems.begin(); it != m_Systems.end(); it++)
+		{
+			if ((*it)->m_Name == name)
+			{
+				m_Systems.erase(it);
+				return;
+			}
+		}
+	}
+
+	SceneSystem* SystemScheduler::GetSystem(const std::string& name)
+	{
+		for (auto& system : m_Systems)
+		{
+			if (system->m_Name == name)
+				return system.get();
+		}
+
+		return nullptr;
+	}
+
+	// 注册顺序就是逻辑上的执行顺序: 后注册的System, 依赖所有在它之前注册、且与它冲突的System
+	void SystemScheduler::BuildGraph()
+	{
+		size_t cnt = m_Systems.size();
+		m_Dependents.assign(cnt, {});
+		m_DependencyCnt.assign(cnt, 0);
+
+		for (uint32_t j = 0; j < cnt; j++)
+		{
+			if (!m_Systems[j]->m_Enabled)
+				continue;
+
+			for (uint32_t i = 0; i < j; i++)
+			{
+				if (!m_Systems[i]->m_Enabled)
+					continue;
+
+				if (m_Systems[i]->ConflictsWith(*m_Systems[j]))
+				{
+					m_Dependents[i].push_back(j);
+					m_DependencyCnt[j]++;
+				}
+			}
+		}
+	}
+
+	void SystemScheduler::Run(Scene& scene, float deltaTime)
+	{
+		BuildGraph();
+
+		size_t cnt = m_Systems.size();
+		m_Timings.resize(cnt);
+
+		for (size_t i = 0; i < cnt; i++)
+		{
+			m_Timings[i] = { m_Systems[i]->m_Name.c_str(), 0.0f };
+			for (auto assure : m_Systems[i]->m_AssurePools)
+				assure(scene.GetRegistry());
+
+			// System通过引用修改Component, entt不会发出信号, 按照声明的写权限标记pool, 供Scene::Snapshot判断
+			if (!m_Systems[i]->m_Enabled)
+				continue;
+
+			if (m_Systems[i]->m_Exclusive)
+				scene.MarkAllDirty();
+			else
+			{
+				for (entt::id_type id : m_Systems[i]->m_Writes)
+				{
+					scene.MarkDirty(id);
+					if (id == entt::type_hash<Transform>::value() && !m_Systems[i]->m_MarksWrittenEntities)
+						scene.MarkAllTransformsMoved();
+				}
+			}
+		}
+
+		// 每个System还剩几个依赖没执行完, 减到0时提交执行
+		std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[cnt]);
+		for (size_t i = 0; i < cnt; i++)
+			remaining[i] = m_DependencyCnt[i];
+
+		JobCounter counter;
+		std::function<void(uint32_t)> submit;
+
+		auto runSystem = [&](uint32_t index)
+		{
+			SceneSystem& system = *m_Systems[index];
+
+			// Instrumentor的记录在JobSystem::Execute里已经做了, 这里只统计给编辑器显示的耗时
+			auto start = std::chrono::steady_clock::now();
+			system.m_Func(scene, deltaTime);
+			auto end = std::chrono::steady_clock::now();
+			m_Timings[index].Milliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+
+			// 在当前Job结束之前提交后续的System, 这样counter不会提前减到0
+			for (uint32_t dependent : m_Dependents[index])
+			{
+				if (remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+					submit(dependent);
+			}
+		};
+
+		submit = [&](uint32_t index)
+		{
+			SceneSystem& system = *m_Systems[index];
+			if (system.m_MainThreadOnly)
+				JobSystem::SubmitToMainThread([&runSystem, index]() { runSystem(index); }, &counter, system.m_Name.c_str());
+			else
+				JobSystem::Submit([&runSystem, index]() { runSystem(index); }, &counter, system.m_Name.c_str());
+		};
+
+		for (uint32_t i = 0; i < cnt; i++)
+		{
+			if (m_Systems[i]->m_Enabled && m_DependencyCnt[i] == 0)
+				submit(i);
+		}
+
+		JobSystem::Wait(counter);
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "entt.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Hazel
+{
+	class Scene;
+
+	// Scene里的一个System, 注册时需要声明它会读哪些Component、写哪些Component
+	// SystemScheduler会根据这些声明判断哪些System之间存在冲突, 不冲突的System会被并行执行
+	class SceneSystem
+	{
+		friend class SystemScheduler;
+	public:
+		using SystemFn = std::function<void(Scene&, float)>;
+
+		template<class... T>
+		SceneSystem& Reads()
+		{
+			(AddAccess<T>(m_Reads), ...);
+			return *this;
+		}
+
+		template<class... T>
+		SceneSystem& Writes()
+		{
+			(AddAccess<T>(m_Writes), ...);
+			return *this;
+		}
+
+		// 会创建、销毁GameObject或者增删Component的System, 与所有System都冲突
+		SceneSystem& Exclusive() { m_Exclusive = true; return *this; }
+
+		// 只能在主线程执行的System, 比如会调用GL的System
+		SceneSystem& MainThreadOnly() { m_MainThreadOnly = true; return *this; }
+
+		// System会对写过Transform的每个entity调用Scene::MarkTransformMoved, SpatialIndex只需要更新这些entity
+		// 没有声明时, 只要声明了Writes<Transform>, 每帧都会重新检查所有Transform
+		SceneSystem& MarksWrittenEntities() { m_MarksWrittenEntities = true; return *this; }
+
+		void SetEnabled(bool enabled) { m_Enabled = enabled; }
+		bool IsEnabled() const { return m_Enabled; }
+		const std::string& GetName() const { return m_Name; }
+
+		bool ConflictsWith(const SceneSystem& other) const;
+
+	private:
+		template<class T>
+		void AddAccess(std::vector<entt::id_type>& ids)
+		{
+			ids.push_back(entt::type_hash<T>::value());
+			// 并行执行时不能再往registry里插入新的pool, 所以提前在主线程里把pool创建好
+			m_AssurePools.push_back([](entt::registry& registry) { (void)registry.storage<T>(); });
+		}
+
+	private:
+		std::string m_Name;
+		SystemFn m_Func;
+		std::vector<entt::id_type> m_Reads;
+		std::vector<entt::id_type> m_Writes;
+		std::vector<void(*)(entt::registry&)> m_AssurePools;
+		bool m_Exclusive = false;
+		bool m_MainThreadOnly = false;
+		bool m_MarksWrittenEntities = false;
+		bool m_Enabled = true;
+	};
+
+	class SystemScheduler
+	{
+	public:
+		struct SystemTiming
+		{
+			const char* Name;
+			float Milliseconds;
+		};
+
+		SceneSystem& AddSystem(const std::string& name, const SceneSystem::SystemFn& func);
+		void RemoveSystem(const std::string& name);
+		SceneSystem* GetSystem(const std::string& name);
+
+		// 每帧调用一次: 根据读写声明构建依赖图, 然后把没有依赖关系的System并行执行
+		void Run(Scene& scene, float deltaTime);
+
+		// 上一次Run里每个System的耗时, 顺序与注册顺序相同
+		const std::vector<SystemTiming>& GetTimings() const { return m_Timings; }
+
+	private:
+		void BuildGraph();
+
+	private:
+		std::vector<std::unique_ptr<SceneSystem>> m_Systems;
+
+		// 依赖图: 第i个System执行完以后, 才能执行m_Dependents[i]里的System
+		std::vector<std::vector<uint32_t>> m_Dependents;
+		std::vector<int> m_DependencyCnt;
+
+		std::vector<SystemTiming> m_Timings;
+	};
+}
@@ -0,0 +1,391 @@
+#include "hzpch.h"
+#include "TransformStore.h"
+#include "Components/Transform.h"
+#include <cmath>
+
+// x64下SSE2是必定存在的, AVX需要编译选项(/arch:AVX)打开才会走8路的版本
+#if defined(_M_X64) || defined(__SSE2__)
+	#define HAZEL_TRANSFORM_SSE 1
+	#include <immintrin.h>
+#endif
+
+namespace Hazel
+{
+	// sin/cos的多项式近似(Cephes的sinf/cosf), 标量、SSE、AVX三个版本的运算顺序完全相同, 结果一致
+	// 先把x规约到[-PI/4, PI/4]: x = j * PI/2 + r, PI/2拆成三段, 保证r的精度, 然后按j所在的象限交换sin/cos和符号
+	static constexpr float TWO_OVER_PI = 0.636619772367581343f;
+	static constexpr float PI_OVER_2_A = 1.5703125f;
+	static constexpr float PI_OVER_2_B = 4.837512969970703125e-4f;
+	static constexpr float PI_OVER_2_C = 7.54978995489188216e-8f;
+	static constexpr float SIN_P0 = -1.6666654611e-1f, SIN_P1 = 8.3321608736e-3f, SIN_P2 = -1.9515295891e-4f;
+	static constexpr float COS_P0 = 4.166664568298827e-2f, COS_P1 = -1.388731625493765e-3f, COS_P2 = 2.443315711809948e-5f;
+
+	static inline void SinCos(float x, float& outSin, float& outCos)
+	{
+		float jf = std::nearbyint(x * TWO_OVER_PI);
+		int j = (int)jf;
+		float r = x - jf * PI_OVER_2_A;
+		r = r - jf * PI_OVER_2_B;
+		r = r - jf * PI_OVER_2_C;
+
+		float z = r * r;
+		float s = ((SIN_P2 * z + SIN_P1) * z + SIN_P0) * z * r + r;
+		float c = ((COS_P2 * z + COS_P1) * z + COS_P0) * z * z - 0.5f * z + 1.0f;
+
+		if (j & 1)
+			std::swap(s, c);
+		outSin = (j & 2) ? -s : s;
+		outCos = ((j + 1) & 2) ? -c : c;
+	}
+
+	// 旋转顺序与之前的Transform::GetTransformMat保持一致: R = Rz * Ry * Rx
+	// 展开后直接写出矩阵的每一项, 省掉三次glm::rotate和两次4x4矩阵乘法
+	static void ComposeOne(float tx, float ty, float tz, float rx, float ry, float rz,
+		float scx, float scy, float scz, glm::mat4& out)
+	{
+		float sx, cx, sy, cy, sz, cz;
+		SinCos(rx, sx, cx);
+		SinCos(ry, sy, cy);
+		SinCos(rz, sz, cz);
+
+		float sysx = sy * sx;
+		float sycx = sy * cx;
+
+		// glm是列主序, out[c][r]代表第c列第r行
+		out[0][0] = cz * cy * scx;
+		out[0][1] = sz * cy * scx;
+		out[0][2] = -sy * scx;
+		out[0][3] = 0.0f;
+
+		out[1][0] = (cz * sysx - sz * cx) * scy;
+		out[1][1] = (sz * sysx + cz * cx) * scy;
+		out[1][2] = cy * sx * scy;
+		out[1][3] = 0.0f;
+
+		out[2][0] = (cz * sycx + sz * sx) * scz;
+		out[2][1] = (sz * sycx - cz * sx) * scz;
+		out[2][2] = cy * cx * scz;
+		out[2][3] = 0.0f;
+
+		out[3][0] = tx;
+		out[3][1] = ty;
+		out[3][2] = tz;
+		out[3][3] = 1.0f;
+	}
+
+#ifdef HAZEL_TRANSFORM_SSE
+	// 输入的x、y、z、w分别是4个GameObject同一列的4行数据, 转置以后每个寄存器正好是一个矩阵的一列
+	static inline void StoreColumn4(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4* out, int column)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&out[0][column][0], x);
+		_mm_storeu_ps(&out[1][column][0], y);
+		_mm_storeu_ps(&out[2][column][0], z);
+		_mm_storeu_ps(&out[3][column][0], w);
+	}
+
+	// SinCos的4路版本, 象限用整数的低两位判断
+	static inline void SinCos4(__m128 x, __m128& outSin, __m128& outCos)
+	{
+		__m128i j = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+		__m128 jf = _mm_cvtepi32_ps(j);
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(jf, _mm_set1_ps(PI_OVER_2_A)));
+		r = _mm_sub_ps(r, _mm_mul_ps(jf, _mm_set1_ps(PI_OVER_2_B)));
+		r = _mm_sub_ps(r, _mm_mul_ps(jf, _mm_set1_ps(PI_OVER_2_C)));
+
+		__m128 z = _mm_mul_ps(r, r);
+		// Horner形式展开, 与标量版本的运算顺序相同
+		__m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P2), z), _mm_set1_ps(SIN_P1));
+		s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(SIN_P0));
+		s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), r), r);
+
+		__m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P2), z), _mm_set1_ps(COS_P1));
+		c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(COS_P0));
+		c = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c, z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z));
+		c = _mm_add_ps(c, _mm_set1_ps(1.0f));
+
+		__m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, one), one));
+		__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, two), 30));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, one), two), 30));
+
+		outSin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+		outCos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+	}
+
+	// 三角函数和矩阵的组合部分都用SSE一次算4个
+	static void ComposeBlock4(const float* tx, const float* ty, const float* tz,
+		const float* rx, const float* ry, const float* rz,
+		const float* scx, const float* scy, const float* scz, glm::mat4* out)
+	{
+		__m128 sx, cx, sy, cy, sz, cz;
+		SinCos4(_mm_loadu_ps(rx), sx, cx);
+		SinCos4(_mm_loadu_ps(ry), sy, cy);
+		SinCos4(_mm_loadu_ps(rz), sz, cz);
+
+		__m128 scaleX = _mm_loadu_ps(scx);
+		__m128 scaleY = _mm_loadu_ps(scy);
+		__m128 scaleZ = _mm_loadu_ps(scz);
+
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+
+		__m128 sysx = _mm_mul_ps(sy, sx);
+		__m128 sycx = _mm_mul_ps(sy, cx);
+
+		// 第0列
+		__m128 c0x = _mm_mul_ps(_mm_mul_ps(cz, cy), scaleX);
+		__m128 c0y = _mm_mul_ps(_mm_mul_ps(sz, cy), scaleX);
+		__m128 c0z = _mm_mul_ps(_mm_sub_ps(zero, sy), scaleX);
+		StoreColumn4(c0x, c0y, c0z, zero, out, 0);
+
+		// 第1列
+		__m128 c1x = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cz, sysx), _mm_mul_ps(sz, cx)), scaleY);
+		__m128 c1y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sz, sysx), _mm_mul_ps(cz, cx)), scaleY);
+		__m128 c1z = _mm_mul_ps(_mm_mul_ps(cy, sx), scaleY);
+		StoreColumn4(c1x, c1y, c1z, zero, out, 1);
+
+		// 第2列
+		__m128 c2x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cz, sycx), _mm_mul_ps(sz, sx)), scaleZ);
+		__m128 c2y = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sz, sycx), _mm_mul_ps(cz, sx)), scaleZ);
+		__m128 c2z = _mm_mul_ps(_mm_mul_ps(cy, cx), scaleZ);
+		StoreColumn4(c2x, c2y, c2z, zero, out, 2);
+
+		// 第3列: Translation
+		StoreColumn4(_mm_loadu_ps(tx), _mm_loadu_ps(ty), _mm_loadu_ps(tz), one, out, 3);
+	}
+#endif
+
+#ifdef __AVX__
+	// 8路版本, 算完以后拆成两个128位的半边, 复用StoreColumn4来转置写回
+	static inline void StoreColumn8(__m256 x, __m256 y, __m256 z, __m256 w, glm::mat4* out, int column)
+	{
+		StoreColumn4(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+			_mm256_castps256_ps128(z), _mm256_castps256_ps128(w), out, column);
+		StoreColumn4(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1),
+			_mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1), out + 4, column);
+	}
+
+	// SinCos的8路版本, AVX没有256位的整数运算, 象限q = j - 4 * floor(j / 4)直接用浮点算
+	static inline void SinCos8(__m256 x, __m256& outSin, __m256& outCos)
+	{
+		__m256 jf = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(TWO_OVER_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256 r = _mm256_sub_ps(x, _mm256_mul_ps(jf, _mm256_set1_ps(PI_OVER_2_A)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(jf, _mm256_set1_ps(PI_OVER_2_B)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(jf, _mm256_set1_ps(PI_OVER_2_C)));
+
+		__m256 z = _mm256_mul_ps(r, r);
+		__m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P2), z), _mm256_set1_ps(SIN_P1));
+		s = _mm256_add_ps(_mm256_mul_ps(s, z), _mm256_set1_ps(SIN_P0));
+		s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), r), r);
+
+		__m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_P2), z), _mm256_set1_ps(COS_P1));
+		c = _mm256_add_ps(_mm256_mul_ps(c, z), _mm256_set1_ps(COS_P0));
+		c = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c, z), z), _mm256_mul_ps(_mm256_set1_ps(0.5f), z));
+		c = _mm256_add_ps(c, _mm256_set1_ps(1.0f));
+
+		__m256 q = _mm256_sub_ps(jf, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(jf, _mm256_set1_ps(0.25f))), _mm256_set1_ps(4.0f)));
+		__m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), three = _mm256_set1_ps(3.0f);
+		__m256 signBit = _mm256_set1_ps(-0.0f);
+		__m256 swap = _mm256_or_ps(_mm256_cmp_ps(q, one, _CMP_EQ_OQ), _mm256_cmp_ps(q, three, _CMP_EQ_OQ));
+		__m256 sinSign = _mm256_and_ps(_mm256_cmp_ps(q, two, _CMP_GE_OQ), signBit);
+		__m256 cosSign = _mm256_and_ps(_mm256_or_ps(_mm256_cmp_ps(q, one, _CMP_EQ_OQ), _mm256_cmp_ps(q, two, _CMP_EQ_OQ)), signBit);
+
+		outSin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+		outCos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+	}
+
+	static void ComposeBlock8(const float* tx, const float* ty, const float* tz,
+		const float* rx, const float* ry, const float* rz,
+		const float* scx, const float* scy, const float* scz, glm::mat4* out)
+	{
+		__m256 sx, cx, sy, cy, sz, cz;
+		SinCos8(_mm256_loadu_ps(rx), sx, cx);
+		SinCos8(_mm256_loadu_ps(ry), sy, cy);
+		SinCos8(_mm256_loadu_ps(rz), sz, cz);
+
+		__m256 scaleX = _mm256_loadu_ps(scx);
+		__m256 scaleY = _mm256_loadu_ps(scy);
+		__m256 scaleZ = _mm256_loadu_ps(scz);
+
+		__m256 zero = _mm256_setzero_ps();
+		__m256 one = _mm256_set1_ps(1.0f);
+
+		__m256 sysx = _mm256_mul_ps(sy, sx);
+		__m256 sycx = _mm256_mul_ps(sy, cx);
+
+		__m256 c0x = _mm256_mul_ps(_mm256_mul_ps(cz, cy), scaleX);
+		__m256 c0y = _mm256_mul_ps(_mm256_mul_ps(sz, cy), scaleX);
+		__m256 c0z = _mm256_mul_ps(_mm256_sub_ps(zero, sy), scaleX);
+		StoreColumn8(c0x, c0y, c0z, zero, out, 0);
+
+		__m256 c1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cz, sysx), _mm256_mul_ps(sz, cx)), scaleY);
+		__m256 c1y = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sz, sysx), _mm256_mul_ps(cz, cx)), scaleY);
+		__m256 c1z = _mm256_mul_ps(_mm256_mul_ps(cy, sx), scaleY);
+		StoreColumn8(c1x, c1y, c1z, zero, out, 1);
+
+		__m256 c2x = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cz, sycx), _mm256_mul_ps(sz, sx)), scaleZ);
+		__m256 c2y = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sz, sycx), _mm256_mul_ps(cz, sx)), scaleZ);
+		__m256 c2z = _mm256_mul_ps(_mm256_mul_ps(cy, cx), scaleZ);
+		StoreColumn8(c2x, c2y, c2z, zero, out, 2);
+
+		StoreColumn8(_mm256_loadu_ps(tx), _mm256_loadu_ps(ty), _mm256_loadu_ps(tz), one, out, 3);
+	}
+#endif
+
+	void TransformStore::Clear()
+	{
+		// 只清空dense部分, m_EntityToIndex保留容量, 下次Push时再覆盖
+		for (entt::entity e : m_Entities)
+			m_EntityToIndex[entt::to_entity(e)] = INVALID_INDEX;
+
+		m_Entities.clear();
+		m_WorldMatrices.clear();
+		m_MinZ = m_MaxZ = 0.0f;
+
+		m_PendingEntities.clear();
+		m_TranslationX.clear(); m_TranslationY.clear(); m_TranslationZ.clear();
+		m_RotationX.clear(); m_RotationY.clear(); m_RotationZ.clear();
+		m_ScaleX.clear(); m_ScaleY.clear(); m_ScaleZ.clear();
+	}
+
+	void TransformStore::Reserve(size_t count)
+	{
+		m_Entities.reserve(count);
+		m_WorldMatrices.reserve(count);
+
+		m_PendingEntities.reserve(count);
+		m_TranslationX.reserve(count); m_TranslationY.reserve(count); m_TranslationZ.reserve(count);
+		m_RotationX.reserve(count); m_RotationY.reserve(count); m_RotationZ.reserve(count);
+		m_ScaleX.reserve(count); m_ScaleY.reserve(count); m_ScaleZ.reserve(count);
+		m_PendingMatrices.reserve(count);
+	}
+
+	uint32_t TransformStore::FindIndex(entt::entity entity) const
+	{
+		auto id = entt::to_entity(entity);
+		if (id >= m_EntityToIndex.size())
+			return INVALID_INDEX;
+
+		uint32_t index = m_EntityToIndex[id];
+		if (index == INVALID_INDEX || m_Entities[index] != entity)
+			return INVALID_INDEX;
+
+		return index;
+	}
+
+	void TransformStore::Push(entt::entity entity, const Transform& t)
+	{
+		if (FindIndex(entity) == INVALID_INDEX)
+		{
+			auto id = entt::to_entity(entity);
+			if (id >= m_EntityToIndex.size())
+				m_EntityToIndex.resize((size_t)id + 1, INVALID_INDEX);
+
+			// id相同、version不同的旧entity正常情况下已经Remove了, 万一还在就直接复用它那一行
+			uint32_t index = m_EntityToIndex[id];
+			if (index == INVALID_INDEX)
+			{
+				index = (uint32_t)m_Entities.size();
+				m_Entities.push_back(entity);
+				m_WorldMatrices.emplace_back(1.0f);
+				m_EntityToIndex[id] = index;
+			}
+			else
+				m_Entities[index] = entity;
+		}
+
+		m_MinZ = std::min<float>(m_MinZ, t.Translation.z);
+		m_MaxZ = std::max<float>(m_MaxZ, t.Translation.z);
+
+		m_PendingEntities.push_back(entity);
+		m_TranslationX.push_back(t.Translation.x);
+		m_TranslationY.push_back(t.Translation.y);
+		m_TranslationZ.push_back(t.Translation.z);
+		m_RotationX.push_back(t.Rotation.x);
+		m_RotationY.push_back(t.Rotation.y);
+		m_RotationZ.push_back(t.Rotation.z);
+		m_ScaleX.push_back(t.Scale.x);
+		m_ScaleY.push_back(t.Scale.y);
+		m_ScaleZ.push_back(t.Scale.z);
+	}
+
+	void TransformStore::Remove(entt::entity entity)
+	{
+		uint32_t index = FindIndex(entity);
+		if (index == INVALID_INDEX)
+			return;
+
+		uint32_t last = (uint32_t)m_Entities.size() - 1;
+		if (index != last)
+		{
+			m_Entities[index] = m_Entities[last];
+			m_WorldMatrices[index] = m_WorldMatrices[last];
+			m_EntityToIndex[entt::to_entity(m_Entities[index])] = index;
+		}
+
+		m_Entities.pop_back();
+		m_WorldMatrices.pop_back();
+		m_EntityToIndex[entt::to_entity(entity)] = INVALID_INDEX;
+	}
+
+	void TransformStore::ComposeWorldMatrices()
+	{
+		size_t count = m_PendingEntities.size();
+		m_PendingMatrices.resize(count);
+
+		size_t i = 0;
+		glm::mat4* out = m_PendingMatrices.data();
+
+#ifdef __AVX__
+		for (; i + 8 <= count; i += 8)
+			ComposeBlock8(&m_TranslationX[i], &m_TranslationY[i], &m_TranslationZ[i],
+				&m_RotationX[i], &m_RotationY[i], &m_RotationZ[i],
+				&m_ScaleX[i], &m_ScaleY[i], &m_ScaleZ[i], out + i);
+#endif
+
+#ifdef HAZEL_TRANSFORM_SSE
+		for (; i + 4 <= count; i += 4)
+			ComposeBlock4(&m_TranslationX[i], &m_TranslationY[i], &m_TranslationZ[i],
+				&m_RotationX[i], &m_RotationY[i], &m_RotationZ[i],
+				&m_ScaleX[i], &m_ScaleY[i], &m_ScaleZ[i], out + i);
+#endif
+
+		// 剩下不足一组的部分走标量
+		for (; i < count; i++)
+			ComposeOne(m_TranslationX[i], m_TranslationY[i], m_TranslationZ[i],
+				m_RotationX[i], m_RotationY[i], m_RotationZ[i],
+				m_ScaleX[i], m_ScaleY[i], m_ScaleZ[i], out[i]);
+
+		// 写回各自的那一行, Push之后又被Remove的跳过, 同一个entity Push了多次时后面的覆盖前面的
+		for (i = 0; i < count; i++)
+		{
+			uint32_t index = FindIndex(m_PendingEntities[i]);
+			if (index != INVALID_INDEX)
+				m_WorldMatrices[index] = out[i];
+		}
+
+		m_PendingEntities.clear();
+		m_TranslationX.clear(); m_TranslationY.clear(); m_TranslationZ.clear();
+		m_RotationX.clear(); m_RotationY.clear(); m_RotationZ.clear();
+		m_ScaleX.clear(); m_ScaleY.clear(); m_ScaleZ.clear();
+	}
+
+	bool TransformStore::TryGetWorldMatrix(entt::entity entity, glm::mat4& outMat) const
+	{
+		uint32_t index = FindIndex(entity);
+		if (index == INVALID_INDEX)
+			return false;
+
+		outMat = m_WorldMatrices[index];
+		return true;
+	}
+
+	glm::mat4 TransformStore::Compose(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale)
+	{
+		glm::mat4 res;
+		ComposeOne(translation.x, translation.y, translation.z, rotation.x, rotation.y, rotation.z,
+			scale.x, scale.y, scale.z, res);
+		return res;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "entt.hpp"
+#include "glm/glm.hpp"
+#include <vector>
+
+namespace Hazel
+{
+	class Transform;
+
+	// 所有Transform的World Matrix缓存, 与entt里Transform的pool并列存在
+	// entt pool里的Transform是AoS布局(Translation、Rotation、Scale挨在一起), 没法向量化
+	// 每帧只把移动过的Transform拷贝出来, 每个分量拆成单独的float数组, 然后用SSE/AVX一次计算4个(或8个)的TRS矩阵
+	// 再写回各自的那一行, 没有移动的GameObject每帧没有任何开销
+	class TransformStore
+	{
+	public:
+		void Clear();
+		void Reserve(size_t count);
+
+		// 记录一个需要重新计算World Matrix的Transform, entity第一次出现时在末尾为它分配一行
+		void Push(entt::entity entity, const Transform& t);
+		// Transform被移除时调用, 末尾的一行挪到它的位置上
+		void Remove(entt::entity entity);
+
+		// 批量计算上次调用以来Push过的Transform的World Matrix
+		void ComposeWorldMatrices();
+
+		size_t Size() const { return m_Entities.size(); }
+		entt::entity GetEntity(uint32_t index) const { return m_Entities[index]; }
+		const glm::mat4& GetWorldMatrix(uint32_t index) const { return m_WorldMatrices[index]; }
+		const std::vector<glm::mat4>& GetWorldMatrices() const { return m_WorldMatrices; }
+		bool TryGetWorldMatrix(entt::entity entity, glm::mat4& outMat) const;
+
+		// 所有Push过的Transform平移的z范围(总是包含0), 透视相机做剔除时用它算出看到的XY范围
+		// 只增不减, 直到下一次Clear
+		float GetMinZ() const { return m_MinZ; }
+		float GetMaxZ() const { return m_MaxZ; }
+
+		// 单个Transform的TRS计算, 与批量计算用的是同一套sin/cos多项式和展开公式, Transform::GetTransformMat也会调用它
+		static glm::mat4 Compose(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale);
+
+	private:
+		static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+		uint32_t FindIndex(entt::entity entity) const;
+
+	private:
+		std::vector<entt::entity> m_Entities;
+		std::vector<uint32_t> m_EntityToIndex;// 以entity的id(不含version)为下标
+		std::vector<glm::mat4> m_WorldMatrices;
+		float m_MinZ = 0.0f, m_MaxZ = 0.0f;
+
+		// 等待ComposeWorldMatrices计算的Transform, SoA布局, 算完以后清空
+		std::vector<entt::entity> m_PendingEntities;
+		std::vector<float> m_TranslationX, m_TranslationY, m_TranslationZ;
+		std::vector<float> m_RotationX, m_RotationY, m_RotationZ;// Radians
+		std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+		std::vector<glm::mat4> m_PendingMatrices;
+	};
+}
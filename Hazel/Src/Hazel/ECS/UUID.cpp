@@ -5,9 +5,9 @@
 
 namespace Hazel
 {
-	static std::random_device s_RandomDevice;
-	static std::mt19937_64 s_Engine(s_RandomDevice());
-	static std::uniform_int_distribution<uint64_t> s_UniformDistribution;
+	// 多个Scene会在不同线程里同时创建GameObject, 所以每个线程用自己的随机数引擎
+	static thread_local std::mt19937_64 s_Engine(std::random_device{}());
+	static thread_local std::uniform_int_distribution<uint64_t> s_UniformDistribution;
 
 	UUID::UUID()
 	{
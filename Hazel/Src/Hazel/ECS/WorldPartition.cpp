@@ -0,0 +1,438 @@
+#include "hzpch.h"
+#include "WorldPartition.h"
+#include "BinarySceneSerializer.h"
+#include "Scene.h"
+#include "Hazel/Utils/PlatformUtils.h"
+#include "yaml-cpp/yaml.h"
+#include <atomic>
+#include <chrono>
+
+namespace Hazel
+{
+	// 格子是只读的, 流式加载和卸载不记入Scene的脏标记和删除列表
+	// 否则它们会一直累积, 也会和编辑器里真正的修改混在一起被增量保存写出去
+	class UntrackedGameObjectChanges
+	{
+	public:
+		UntrackedGameObjectChanges(Scene& scene) : m_Scene(scene) { m_Scene.SetGameObjectChangeTracking(false); }
+		~UntrackedGameObjectChanges() { m_Scene.SetGameObjectChangeTracking(true); }
+
+	private:
+		Scene& m_Scene;
+	};
+
+	static const int32_t WORLD_PARTITION_VERSION = 1;
+
+	WorldPartition::~WorldPartition()
+	{
+		Close();
+	}
+
+	static bool WriteChunk(std::shared_ptr<Scene> scene, const std::vector<GameObject>& gos, const std::filesystem::path& path, uint64_t& outBytes)
+	{
+		std::vector<uint8_t> data;
+		BinarySceneSerializer::Serialize(scene, gos, data);
+
+		std::ofstream fout(path, std::ios::binary);
+		if (!fout)
+			return false;
+
+		fout.write((const char*)data.data(), data.size());
+		outBytes = data.size();
+		return (bool)fout;
+	}
+
+	bool WorldPartition::Build(std::shared_ptr<Scene> scene, const std::string& manifestPath, float cellSize)
+	{
+		if (cellSize <= 0.0f)
+			return false;
+
+		std::filesystem::path manifest(manifestPath);
+		std::filesystem::path directory = manifest.parent_path();
+		std::string stem = manifest.stem().string();
+
+		// 按格子分组, 格子内保持Hierarchy里的顺序; 用有序的map, 同一个Scene每次写出的格子表都相同
+		struct ChunkEntry
+		{
+			int32_t X;
+			int32_t Y;
+			std::string File;
+			std::vector<GameObject> GameObjects;
+			uint64_t Bytes = 0;
+		};
+
+		const entt::registry& registry = scene->GetRegistry();
+		std::map<std::pair<int32_t, int32_t>, std::vector<GameObject>> grouped;
+		std::vector<GameObject> globals;
+		for (const GameObject& go : scene->GetGameObjects())
+		{
+			const Transform* t = registry.try_get<Transform>(go);
+			if (!t || registry.all_of<CameraComponent>(go))
+			{
+				globals.push_back(go);
+				continue;
+			}
+
+			int32_t x = (int32_t)std::floor(t->Translation.x / cellSize);
+			int32_t y = (int32_t)std::floor(t->Translation.y / cellSize);
+			grouped[{ x, y }].push_back(go);
+		}
+
+		std::vector<ChunkEntry> chunks;
+		chunks.reserve(grouped.size());
+		for (auto& [coord, gos] : grouped)
+		{
+			std::string file = stem + "_" + std::to_string(coord.first) + "_" + std::to_string(coord.second) + ".hscene";
+			chunks.push_back({ coord.first, coord.second, file, std::move(gos) });
+		}
+
+		// 每个格子的烘焙只读registry, 可以并行
+		std::atomic<bool> failed = false;
+		JobSystem::ParallelFor(chunks.size(), 0, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					if (!WriteChunk(scene, chunks[i].GameObjects, directory / chunks[i].File, chunks[i].Bytes))
+						failed = true;
+				}
+			}, "BuildWorldPartition");
+
+		std::string globalFile = stem + "_Global.hscene";
+		uint64_t globalBytes = 0;
+		if (failed || !WriteChunk(scene, globals, directory / globalFile, globalBytes))
+		{
+			CORE_LOG_ERROR("Failed to write world partition chunks: {0}", manifestPath);
+			return false;
+		}
+
+		YAML::Emitter out;
+		out << YAML::BeginMap;
+		out << YAML::Key << "WorldPartition" << YAML::Value << WORLD_PARTITION_VERSION;
+		out << YAML::Key << "CellSize" << YAML::Value << cellSize;
+		out << YAML::Key << "Global" << YAML::Value << globalFile;
+		out << YAML::Key << "Cells" << YAML::Value << YAML::BeginSeq;
+		for (const ChunkEntry& chunk : chunks)
+		{
+			out << YAML::Flow << YAML::BeginMap;
+			out << YAML::Key << "X" << YAML::Value << chunk.X;
+			out << YAML::Key << "Y" << YAML::Value << chunk.Y;
+			out << YAML::Key << "File" << YAML::Value << chunk.File;
+			out << YAML::Key << "Bytes" << YAML::Value << chunk.Bytes;
+			out << YAML::EndMap;
+		}
+		out << YAML::EndSeq;
+		out << YAML::EndMap;
+
+		std::ofstream fout(manifestPath);
+		fout << out.c_str();
+		return (bool)fout;
+	}
+
+	bool WorldPartition::Open(std::shared_ptr<Scene> scene, const std::string& manifestPath)
+	{
+		Close();
+
+		YAML::Node root;
+		try
+		{
+			root = YAML::LoadFile(manifestPath);
+		}
+		catch (const YAML::Exception& e)
+		{
+			CORE_LOG_ERROR("Failed to load world partition {0}: {1}", manifestPath, e.what());
+			return false;
+		}
+
+		if (!root["WorldPartition"] || root["WorldPartition"].as<int32_t>() != WORLD_PARTITION_VERSION)
+		{
+			CORE_LOG_ERROR("{0} is not a world partition manifest, or it needs to be built again", manifestPath);
+			return false;
+		}
+
+		m_CellSize = root["CellSize"].as<float>();
+		m_Directory = std::filesystem::path(manifestPath).parent_path().string();
+
+		for (const YAML::Node& node : root["Cells"])
+		{
+			std::unique_ptr<Cell> cell = std::make_unique<Cell>();
+			cell->X = node["X"].as<int32_t>();
+			cell->Y = node["Y"].as<int32_t>();
+			cell->File = node["File"].as<std::string>();
+			cell->Bytes = node["Bytes"].as<uint64_t>();
+			m_CellMap[GetCellKey(cell->X, cell->Y)] = cell.get();
+			m_Cells.push_back(std::move(cell));
+		}
+
+		// 全局数据块不大, 直接在主线程同步加载
+		std::string globalPath = (std::filesystem::path(m_Directory) / root["Global"].as<std::string>()).string();
+		MappedFile file;
+		UntrackedGameObjectChanges untracked(*scene);
+		if (!file.Open(globalPath.c_str()) || !BinarySceneSerializer::Deserialize(scene, file.GetData(), file.GetSize(), &m_GlobalEntities))
+		{
+			CORE_LOG_ERROR("Failed to load world partition global chunk: {0}", globalPath);
+			m_Cells.clear();
+			m_CellMap.clear();
+			return false;
+		}
+
+		m_Scene = scene;
+		return true;
+	}
+
+	void WorldPartition::Close()
+	{
+		if (!m_Scene)
+			return;
+
+		// worker线程还在往Cell里写数据, 要等它们结束以后才能释放
+		for (Cell* cell : m_LoadingCells)
+			JobSystem::Wait(cell->Counter);
+
+		std::vector<entt::entity> entities = std::move(m_GlobalEntities);
+		for (Cell* cell : m_LoadedCells)
+			entities.insert(entities.end(), cell->Entities.begin(), cell->Entities.end());
+		{
+			UntrackedGameObjectChanges untracked(*m_Scene);
+			m_Scene->DestroyGameObjects(entities);
+		}
+
+		m_Scene = nullptr;
+		m_Directory.clear();
+		m_Cells.clear();
+		m_CellMap.clear();
+		m_LoadingCells.clear();
+		m_LoadedCells.clear();
+		m_GlobalEntities.clear();
+		m_ResidentBytes = 0;
+	}
+
+	template<class Fn>
+	void WorldPartition::ForEachCellIn(const CellRange& range, Fn&& fn)
+	{
+		// 范围里的坐标比格子总数还多时, 直接遍历所有格子
+		uint64_t area = (uint64_t)((int64_t)range.MaxX - range.MinX + 1) * (uint64_t)((int64_t)range.MaxY - range.MinY + 1);
+		if (area > m_Cells.size())
+		{
+			for (const std::unique_ptr<Cell>& cell : m_Cells)
+			{
+				if (range.Contains(*cell))
+					fn(*cell);
+			}
+			return;
+		}
+
+		for (int32_t y = range.MinY; y <= range.MaxY; y++)
+		{
+			for (int32_t x = range.MinX; x <= range.MaxX; x++)
+			{
+				auto it = m_CellMap.find(GetCellKey(x, y));
+				if (it != m_CellMap.end())
+					fn(*it->second);
+			}
+		}
+	}
+
+	void WorldPartition::ComputeViewBounds(const glm::mat4& viewProjection, glm::vec2& outMin, glm::vec2& outMax)
+	{
+		SpatialIndex::ComputeViewBounds(viewProjection, 0.0f, 0.0f, outMin, outMax);
+	}
+
+	void WorldPartition::Update(const glm::mat4& viewProjection)
+	{
+		glm::vec2 viewMin, viewMax;
+		ComputeViewBounds(viewProjection, viewMin, viewMax);
+		Update(viewMin, viewMax);
+	}
+
+	void WorldPartition::Update(const glm::vec2& viewMin, const glm::vec2& viewMax)
+	{
+		if (!m_Scene)
+			return;
+
+		MergeFinishedLoads();
+
+		CellRange visible = GetCellRange(viewMin, viewMax);
+		CellRange prefetch = visible.Expand((int32_t)m_PrefetchRing);
+		// 多留一圈再卸载, 相机在格子边界附近来回移动时不会反复加载
+		CellRange keep = prefetch.Expand(1);
+		glm::vec2 center = (viewMin + viewMax) * 0.5f;
+
+		for (size_t i = 0; i < m_LoadedCells.size();)
+		{
+			if (!keep.Contains(*m_LoadedCells[i]))
+				Unload(*m_LoadedCells[i]);
+			else
+				i++;
+		}
+
+		for (Cell* cell : m_LoadingCells)
+			cell->Cancelled = !keep.Contains(*cell);
+
+		std::vector<Cell*> candidates;
+		ForEachCellIn(prefetch, [&candidates](Cell& cell)
+			{
+				if (cell.State == CellState::Unloaded && !cell.ReadFailed)
+					candidates.push_back(&cell);
+			});
+
+		// 先加载看得见的格子, 再按离相机由近到远
+		std::sort(candidates.begin(), candidates.end(), [&](const Cell* a, const Cell* b)
+			{
+				bool aVisible = visible.Contains(*a);
+				bool bVisible = visible.Contains(*b);
+				if (aVisible != bVisible)
+					return aVisible;
+				return GetDistanceSq(*a, center) < GetDistanceSq(*b, center);
+			});
+
+		for (Cell* cell : candidates)
+		{
+			if (m_LoadingCells.size() >= m_MaxConcurrentLoads)
+				break;
+
+			// 超出预算时先卸载范围外最远的格子; 看得见的格子总会加载, 预取的格子放不下就等以后
+			bool isVisible = visible.Contains(*cell);
+			const CellRange& evictRange = isVisible ? visible : prefetch;
+			while (m_ResidentBytes + cell->Bytes > m_MemoryBudget && EvictFarthest(evictRange, center))
+				;
+
+			if (!isVisible && m_ResidentBytes + cell->Bytes > m_MemoryBudget)
+				break;
+
+			StartLoad(*cell);
+		}
+	}
+
+	WorldPartition::CellRange WorldPartition::GetCellRange(const glm::vec2& min, const glm::vec2& max) const
+	{
+		// 相机拉得很远时坐标可能非常大, 先限制范围再转成整数
+		auto toCell = [this](float v)
+		{
+			float c = std::floor(v / m_CellSize);
+			return (int32_t)std::min<float>(1e9f, std::max<float>(-1e9f, c));
+		};
+
+		return { toCell(min.x), toCell(min.y), toCell(max.x), toCell(max.y) };
+	}
+
+	float WorldPartition::GetDistanceSq(const Cell& cell, const glm::vec2& point) const
+	{
+		glm::vec2 cellCenter = (glm::vec2((float)cell.X, (float)cell.Y) + 0.5f) * m_CellSize;
+		glm::vec2 d = cellCenter - point;
+		return glm::dot(d, d);
+	}
+
+	void WorldPartition::MergeFinishedLoads()
+	{
+		auto start = std::chrono::steady_clock::now();
+		uint32_t merged = 0;
+		for (size_t i = 0; i < m_LoadingCells.size();)
+		{
+			Cell* cell = m_LoadingCells[i];
+			if (!cell->Counter.IsDone())
+			{
+				i++;
+				continue;
+			}
+
+			// 每帧至少合并一个格子, 之后超出时间预算的留到下一帧
+			float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (merged > 0 && elapsedMs >= m_MergeBudgetMs)
+				break;
+
+			m_LoadingCells[i] = m_LoadingCells.back();
+			m_LoadingCells.pop_back();
+
+			bool loaded = false;
+			if (!cell->Cancelled && !cell->ReadFailed)
+			{
+				UntrackedGameObjectChanges untracked(*m_Scene);
+				loaded = BinarySceneSerializer::Deserialize(m_Scene, cell->Data.data(), cell->Data.size(), &cell->Entities);
+				cell->ReadFailed = !loaded;
+				merged++;
+			}
+
+			if (cell->ReadFailed)
+				CORE_LOG_ERROR("Failed to stream world partition cell: {0}", cell->File);
+
+			if (loaded)
+			{
+				cell->State = CellState::Loaded;
+				m_LoadedCells.push_back(cell);
+			}
+			else
+			{
+				cell->State = CellState::Unloaded;
+				m_ResidentBytes -= cell->Bytes;
+			}
+
+			std::vector<uint8_t>().swap(cell->Data);
+		}
+	}
+
+	void WorldPartition::StartLoad(Cell& cell)
+	{
+		cell.State = CellState::Loading;
+		cell.Cancelled = false;
+		m_ResidentBytes += cell.Bytes;
+		m_LoadingCells.push_back(&cell);
+
+		// Cell由unique_ptr持有, 地址不变; Close会等读取结束以后才释放
+		Cell* target = &cell;
+		std::string path = (std::filesystem::path(m_Directory) / cell.File).string();
+		JobSystem::Submit([target, path]()
+			{
+				std::ifstream fin(path, std::ios::binary | std::ios::ate);
+				if (!fin)
+				{
+					target->ReadFailed = true;
+					return;
+				}
+
+				size_t size = (size_t)fin.tellg();
+				fin.seekg(0);
+				target->Data.resize(size);
+				if (!fin.read((char*)target->Data.data(), size))
+					target->ReadFailed = true;
+			}, &cell.Counter, "StreamWorldCell");
+	}
+
+	void WorldPartition::Unload(Cell& cell)
+	{
+		{
+			UntrackedGameObjectChanges untracked(*m_Scene);
+			m_Scene->DestroyGameObjects(cell.Entities);
+		}
+		cell.Entities.clear();
+		cell.State = CellState::Unloaded;
+		m_ResidentBytes -= cell.Bytes;
+
+		auto it = std::find(m_LoadedCells.begin(), m_LoadedCells.end(), &cell);
+		*it = m_LoadedCells.back();
+		m_LoadedCells.pop_back();
+	}
+
+	bool WorldPartition::EvictFarthest(const CellRange& range, const glm::vec2& point)
+	{
+		Cell* farthest = nullptr;
+		float farthestDistance = 0.0f;
+		for (Cell* cell : m_LoadedCells)
+		{
+			if (range.Contains(*cell))
+				continue;
+
+			float distance = GetDistanceSq(*cell, point);
+			if (!farthest || distance > farthestDistance)
+			{
+				farthest = cell;
+				farthestDistance = distance;
+			}
+		}
+
+		if (!farthest)
+			return false;
+
+		Unload(*farthest);
+		return true;
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "Hazel/Core/JobSystem.h"
+#include "entt.hpp"
+#include "glm/glm.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Hazel
+{
+	class Scene;
+
+	// 开放世界的2D地图按XY平面切成固定大小的格子, 每个格子烘焙成一个独立的*.hscene文件
+	// 运行时只有相机看到的格子和外面一圈预取的格子在内存里, 离开范围的格子整体卸载
+	// - 读文件在worker线程里, 插入registry在主线程里, 每帧花在插入上的时间有上限
+	// - 看得见的格子总会被加载, 预取的格子受内存预算限制, 超出时先卸载离相机最远的格子
+	// 格子里的数据是只读的, 卸载时直接销毁, 运行期间的修改不会写回文件
+	// 没有Transform的GameObject和相机放在全局数据块里, Open时同步加载, 一直留在内存里
+	class WorldPartition
+	{
+	public:
+		WorldPartition() = default;
+		~WorldPartition();
+
+		WorldPartition(const WorldPartition&) = delete;
+		WorldPartition& operator=(const WorldPartition&) = delete;
+
+		// 把scene按cellSize切成格子写出: manifestPath(*.world)记录格子表, 格子文件放在它旁边
+		static bool Build(std::shared_ptr<Scene> scene, const std::string& manifestPath, float cellSize);
+
+		// 读取格子表并加载全局数据块, 格子要等Update时才开始加载
+		bool Open(std::shared_ptr<Scene> scene, const std::string& manifestPath);
+		// 等待所有读取完成, 卸载所有格子和全局数据块
+		void Close();
+		bool IsOpen() const { return m_Scene != nullptr; }
+
+		// 每帧调用一次, viewMin和viewMax是相机在XY平面上看到的范围
+		void Update(const glm::vec2& viewMin, const glm::vec2& viewMax);
+		// 用相机的ViewProjection矩阵算出它在z = 0平面上看到的范围
+		void Update(const glm::mat4& viewProjection);
+		static void ComputeViewBounds(const glm::mat4& viewProjection, glm::vec2& outMin, glm::vec2& outMax);
+
+		// 看到的格子外面再预取几圈
+		void SetPrefetchRing(uint32_t cells) { m_PrefetchRing = cells; }
+		// 加载中和已加载的格子文件大小之和的上限
+		void SetMemoryBudget(uint64_t bytes) { m_MemoryBudget = bytes; }
+		void SetMaxConcurrentLoads(uint32_t count) { m_MaxConcurrentLoads = count; }
+		void SetMergeBudgetMs(float ms) { m_MergeBudgetMs = ms; }
+
+		uint64_t GetResidentBytes() const { return m_ResidentBytes; }
+		uint32_t GetLoadedCellCount() const { return (uint32_t)m_LoadedCells.size(); }
+		uint32_t GetCellCount() const { return (uint32_t)m_Cells.size(); }
+
+	private:
+		enum class CellState
+		{
+			Unloaded,
+			Loading,
+			Loaded
+		};
+
+		struct Cell
+		{
+			int32_t X = 0;
+			int32_t Y = 0;
+			std::string File;
+			uint64_t Bytes = 0;
+			CellState State = CellState::Unloaded;
+			bool Cancelled = false;// 读取期间离开了范围, 读完以后直接丢弃
+			bool ReadFailed = false;
+			std::vector<uint8_t> Data;// worker线程读出的文件内容, 插入registry以后释放
+			std::vector<entt::entity> Entities;
+			JobCounter Counter;
+		};
+
+		// 格子坐标的闭区间
+		struct CellRange
+		{
+			int32_t MinX, MinY, MaxX, MaxY;
+
+			bool Contains(const Cell& cell) const { return cell.X >= MinX && cell.X <= MaxX && cell.Y >= MinY && cell.Y <= MaxY; }
+			CellRange Expand(int32_t n) const { return { MinX - n, MinY - n, MaxX + n, MaxY + n }; }
+		};
+
+		static uint64_t GetCellKey(int32_t x, int32_t y) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+
+		CellRange GetCellRange(const glm::vec2& min, const glm::vec2& max) const;
+		template<class Fn>
+		void ForEachCellIn(const CellRange& range, Fn&& fn);
+		float GetDistanceSq(const Cell& cell, const glm::vec2& point) const;
+
+		void MergeFinishedLoads();
+		void StartLoad(Cell& cell);
+		void Unload(Cell& cell);
+		// 卸载range之外离point最远的格子, 没有可以卸载的格子时返回false
+		bool EvictFarthest(const CellRange& range, const glm::vec2& point);
+
+	private:
+		std::shared_ptr<Scene> m_Scene;
+		std::string m_Directory;
+		float m_CellSize = 64.0f;
+
+		std::vector<std::unique_ptr<Cell>> m_Cells;
+		std::unordered_map<uint64_t, Cell*> m_CellMap;
+		std::vector<Cell*> m_LoadingCells;
+		std::vector<Cell*> m_LoadedCells;
+		std::vector<entt::entity> m_GlobalEntities;
+		uint64_t m_ResidentBytes = 0;
+
+		uint32_t m_PrefetchRing = 1;
+		uint64_t m_MemoryBudget = 256ull * 1024 * 1024;
+		uint32_t m_MaxConcurrentLoads = 4;
+		float m_MergeBudgetMs = 2.0f;
+	};
+}
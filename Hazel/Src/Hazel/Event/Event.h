@@ -37,6 +37,7 @@ namespace Hazel
 	{
 	public:
 		friend class EventDispatcher;
+		virtual ~Event() = default;
 		virtual const char* GetName() const = 0;
 		virtual const EventType GetEventType() const = 0;
 		virtual int GetCategoryFlag() const = 0;
@@ -58,16 +59,15 @@ namespace Hazel
 	// 根据wrap的Event类型产生了对应的Dispatch事件的函数
 	class HAZEL_API EventDispatcher
 	{
-		template<typename T>
-		using EventHandler = std::function<bool(T&)>;//EventHandler存储了一个输入为任意类型的引用，返回值为bool的函数指针
 	public:
 		EventDispatcher(Event& e):
 			m_Event(e){}
 
 		// Dispatch会直接执行响应事件对应的函数指针对应的函数
 		// T指的是事件类型, 如果输入的类型没有GetStaticType会报错
-		template<typename T>
-		void Dispatch(EventHandler<T> handler)
+		// F是任意输入为T&、返回值为bool的可调用对象, 直接按模板参数传入, 不再每次都构造std::function
+		template<typename T, typename F>
+		void Dispatch(const F& handler)
 		{
 			if (m_Event.m_Handled)
 				return;
@@ -0,0 +1,71 @@
+#include "hzpch.h"
+#include "EventQueue.h"
+
+namespace Hazel
+{
+	EventQueue::~EventQueue()
+	{
+		Reset();
+	}
+
+	void EventQueue::Dispatch()
+	{
+		// 监听者在处理Event时可能会再Push新的Event, 所以按下标遍历, 新的Event也在本次一起处理
+		for (size_t i = 0; i < m_Events.size(); i++)
+		{
+			Event& e = *m_Events[i];
+			// 已经分发过的Event不能再被合并, 否则分发过程中新Push的Event会覆盖掉正在处理的Event
+			m_LastBarrier = std::max<uint32_t>(m_LastBarrier, (uint32_t)i + 1);
+
+			for (const Listener& listener : m_Listeners[(uint32_t)e.GetEventType()])
+			{
+				if (listener.Fn(listener.Instance, e))
+					e.MarkHandled();
+
+				if (e.IsHandled())
+					break;
+			}
+
+			if (!e.IsHandled() && m_Fallback.Fn)
+				m_Fallback.Fn(m_Fallback.Instance, e);
+		}
+
+		m_LastCoalescedCount = m_CoalescedCount;
+		Reset();
+	}
+
+	void* EventQueue::Allocate(size_t size, size_t alignment)
+	{
+		HAZEL_ASSERT(size <= BLOCK_SIZE, "Event is larger than the block size of EventQueue!");
+
+		while (true)
+		{
+			if (m_CurrentBlock == m_Blocks.size())
+				m_Blocks.push_back(std::make_unique<uint8_t[]>(BLOCK_SIZE));
+
+			uintptr_t base = (uintptr_t)m_Blocks[m_CurrentBlock].get();
+			size_t offset = (base + m_Offset + alignment - 1) / alignment * alignment - base;
+			if (offset + size <= BLOCK_SIZE)
+			{
+				m_Offset = offset + size;
+				return (void*)(base + offset);
+			}
+
+			m_CurrentBlock++;
+			m_Offset = 0;
+		}
+	}
+
+	void EventQueue::Reset()
+	{
+		for (Event* e : m_Events)
+			e->~Event();
+
+		m_Events.clear();
+		m_LastCoalescable.fill(INVALID_INDEX);
+		m_LastBarrier = 0;
+		m_CoalescedCount = 0;
+		m_CurrentBlock = 0;
+		m_Offset = 0;
+	}
+}
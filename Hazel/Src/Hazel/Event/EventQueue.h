@@ -0,0 +1,123 @@
+#pragma once
+#include "Event.h"
+#include <array>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace Hazel
+{
+	// 一帧内收到的Event都放在这里, 由Application在每帧开始时统一分发
+	// - Event本身分配在按帧重置的线性内存池里, 不会每个Event都new一次
+	// - 连续到来的MouseMoved、WindowResized只保留最后一个, 高回报率鼠标一帧内的几十个移动事件只会分发一次
+	// - 监听者按EventType分表存放, 分发时只遍历对应类型的表, 用函数指针调用, 不经过std::function
+	// glfw的回调都在主线程里, 所以Push和Dispatch都只能在主线程调用
+	class HAZEL_API EventQueue
+	{
+	public:
+		// 返回true表示Event已被处理, 后面的监听者和Layer都不会再收到它
+		using ListenerFn = bool(*)(void* instance, Event& e);
+
+		EventQueue() = default;
+		~EventQueue();
+
+		EventQueue(const EventQueue&) = delete;
+		EventQueue& operator=(const EventQueue&) = delete;
+
+		template<class T, class... Args>
+		void Push(Args&&... args)
+		{
+			uint32_t type = (uint32_t)T::GetStaticType();
+
+			// 上一个同类型的Event之后没有其他不可合并的Event, 直接用新的数据覆盖它, 保证与其他Event的相对顺序不变
+			if (IsCoalescable(T::GetStaticType()) && m_LastCoalescable[type] != INVALID_INDEX
+				&& m_LastCoalescable[type] >= m_LastBarrier)
+			{
+				Event*& slot = m_Events[m_LastCoalescable[type]];
+				slot->~Event();
+				slot = new (slot) T(std::forward<Args>(args)...);
+				m_CoalescedCount++;
+				return;
+			}
+
+			Event* e = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+			uint32_t index = (uint32_t)m_Events.size();
+			m_Events.push_back(e);
+
+			if (IsCoalescable(T::GetStaticType()))
+				m_LastCoalescable[type] = index;
+			else
+				m_LastBarrier = index + 1;
+		}
+
+		// 注册类型为T的监听者, 先注册的先收到, 所有监听者都先于Fallback收到Event
+		template<class T, class C, bool(C::*Method)(T&)>
+		void Subscribe(C* instance)
+		{
+			ListenerFn fn = [](void* self, Event& e) { return (static_cast<C*>(self)->*Method)(static_cast<T&>(e)); };
+			m_Listeners[(uint32_t)T::GetStaticType()].push_back({ instance, fn });
+		}
+
+		template<class C>
+		void Unsubscribe(C* instance)
+		{
+			for (auto& listeners : m_Listeners)
+			{
+				listeners.erase(std::remove_if(listeners.begin(), listeners.end(),
+					[instance](const Listener& l) { return l.Instance == instance; }), listeners.end());
+			}
+		}
+
+		// 没有被监听者处理掉的Event最后都交给这里, Application用它把Event逆序传给LayerStack
+		template<class C, void(C::*Method)(Event&)>
+		void SetFallback(C* instance)
+		{
+			m_Fallback = { instance, [](void* self, Event& e) { (static_cast<C*>(self)->*Method)(e); return e.IsHandled(); } };
+		}
+
+		// 按照Push的顺序分发本帧所有的Event, 然后重置内存池
+		void Dispatch();
+
+		size_t GetQueuedCount() const { return m_Events.size(); }
+		// 上一次Dispatch之前被合并掉的Event个数, 用于统计
+		uint32_t GetLastCoalescedCount() const { return m_LastCoalescedCount; }
+
+	private:
+		struct Listener
+		{
+			void* Instance;
+			ListenerFn Fn;
+		};
+
+		static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+		static constexpr uint32_t EVENT_TYPE_COUNT = (uint32_t)EventType::MouseScrolled + 1;
+		static constexpr size_t BLOCK_SIZE = 4096;
+
+		static bool IsCoalescable(EventType type) { return type == EventType::MouseMoved || type == EventType::WindowResized; }
+
+		void* Allocate(size_t size, size_t alignment);
+		void Reset();
+
+	private:
+		std::vector<Event*> m_Events;
+		std::array<uint32_t, EVENT_TYPE_COUNT> m_LastCoalescable = MakeInvalidIndices();
+		uint32_t m_LastBarrier = 0;// 最后一个不可合并的Event之后的位置
+		uint32_t m_CoalescedCount = 0;
+		uint32_t m_LastCoalescedCount = 0;
+
+		std::array<std::vector<Listener>, EVENT_TYPE_COUNT> m_Listeners;
+		Listener m_Fallback = { nullptr, nullptr };
+
+		// 内存池由若干固定大小的Block组成, Reset时只把游标归零, Block留给下一帧复用
+		std::vector<std::unique_ptr<uint8_t[]>> m_Blocks;
+		size_t m_CurrentBlock = 0;
+		size_t m_Offset = 0;
+
+		static std::array<uint32_t, EVENT_TYPE_COUNT> MakeInvalidIndices()
+		{
+			std::array<uint32_t, EVENT_TYPE_COUNT> res;
+			res.fill(INVALID_INDEX);
+			return res;
+		}
+	};
+}
@@ -1,26 +1,399 @@
 #include "hzpch.h"
 #include "Physics2D.h"
+#include "Hazel/Core/JobSystem.h"
 
 namespace Hazel
 {
-	std::shared_ptr<b2World> Physics2D::m_World = nullptr;
-	float Physics2D::m_FixedTimeStep = 0.0f;
+	// b2Distance和b2TimeOfImpact会累加Box2D里非原子的全局统计变量(b2_gjkCalls、b2_toiCalls等)
+	// Box2D是第三方子模块, 不在这里修改它; 所有会走到这两个函数的调用(Step和Overlap的精确测试)都在这把锁里执行
+	// 不同Scene的其他System仍然可以并行, 只有物理模拟这一步在多个Scene之间是串行的
+	static std::mutex s_Box2DGlobalsMutex;
 
-	void Physics2D::Init(float gravityX, float gravityY)
+	static entt::entity GetEntity(b2Fixture* fixture)
 	{
-		//if (m_World == nullptr)
+		return (entt::entity)fixture->GetBody()->GetUserData().pointer;
+	}
+
+	// 保留最近的命中: 返回fraction会让broadphase把射线截短到这里, 后面更远的Fixture就不会再被检查
+	class ClosestRaycastCallback : public b2RayCastCallback
+	{
+	public:
+		float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+		{
+			Hit.Entity = GetEntity(fixture);
+			Hit.Point = { point.x, point.y };
+			Hit.Normal = { normal.x, normal.y };
+			Hit.Fraction = fraction;
+			return fraction;
+		}
+
+		PhysicsRaycastHit Hit;
+	};
+
+	// 用shape(已经在世界坐标里)对fixture做精确测试
+	// b2TestOverlap会调用b2Distance, 调用者要持有s_Box2DGlobalsMutex
+	static bool TestOverlap(const b2Shape& queryShape, b2Fixture* fixture)
+	{
+		b2Transform identity;
+		identity.SetIdentity();
+
+		const b2Shape* shape = fixture->GetShape();
+		const b2Transform& xf = fixture->GetBody()->GetTransform();
+		for (int32 child = 0; child < shape->GetChildCount(); child++)
+		{
+			if (b2TestOverlap(shape, child, &queryShape, 0, xf, identity))
+				return true;
+		}
+
+		return false;
+	}
+
+	// broadphase给出的是包围盒(还是放大过的)相交的Fixture, 只收集起来, 精确测试由调用者做
+	class CandidateCallback : public b2QueryCallback
+	{
+	public:
+		CandidateCallback(std::vector<b2Fixture*>& out) : m_Out(out) {}
+
+		bool ReportFixture(b2Fixture* fixture) override
 		{
-			// 创建世界时需要设置重力加速度
-			b2Vec2 gravity(gravityX, gravityY);
-			// b2World is the physics hub that manages memory, objects, and simulation.
-			m_World = std::make_shared<b2World>(gravity);
+			m_Out.push_back(fixture);
+			return true;
 		}
-		
-		m_FixedTimeStep = 1.f / 60.f;
+
+	private:
+		std::vector<b2Fixture*>& m_Out;
+	};
+
+	Physics2D::Physics2D(float gravityX, float gravityY)
+	{
+		// 创建世界时需要设置重力加速度
+		b2Vec2 gravity(gravityX, gravityY);
+		// b2World is the physics hub that manages memory, objects, and simulation.
+		m_World = std::make_unique<b2World>(gravity);
+		m_World->SetContactListener(&m_ContactListener);
+	}
+
+	void Physics2D::ResetWorld()
+	{
+		b2Vec2 gravity = m_World->GetGravity();
+		m_World.reset();
+		m_World = std::make_unique<b2World>(gravity);
+		m_World->SetContactListener(&m_ContactListener);
+		m_ContactListener.Clear();
+		m_Accumulator = 0.0f;
+		m_Tick = 0;
+		m_History.Clear();
 	}
 
 	void Physics2D::Update()
 	{
-		m_World->Step(m_FixedTimeStep, velocityIterations, positionIterations);
+		m_ContactListener.SetTick(m_Tick + 1);
+		{
+			std::lock_guard<std::mutex> lock(s_Box2DGlobalsMutex);
+			m_World->Step(m_FixedTimeStep, velocityIterations, positionIterations);
+		}
+		m_Tick++;
+
+		if (m_History.GetCapacity() > 0)
+			Capture(m_History.Push(m_Tick));
+	}
+
+	void Physics2D::Capture(PhysicsSnapshot& snapshot) const
+	{
+		snapshot.Tick = m_Tick;
+		snapshot.Bodies.clear();
+		snapshot.Contacts.clear();
+		snapshot.Bodies.reserve(m_World->GetBodyCount());
+
+		for (b2Body* body = m_World->GetBodyList(); body; body = body->GetNext())
+		{
+			// 静态的b2Body不会动, 不需要记录
+			if (body->GetType() == b2_staticBody)
+				continue;
+
+			const b2Vec2& pos = body->GetPosition();
+			const b2Vec2& v = body->GetLinearVelocity();
+			snapshot.Bodies.push_back({ (uint32_t)body->GetUserData().pointer, pos.x, pos.y, body->GetAngle(),
+				v.x, v.y, body->GetAngularVelocity(), body->IsAwake() ? 1u : 0u });
+		}
+
+		for (b2Contact* contact = m_World->GetContactList(); contact; contact = contact->GetNext())
+		{
+			if (!contact->IsTouching())
+				continue;
+
+			const b2Manifold* manifold = contact->GetManifold();
+			PhysicsContactState state = {};
+			state.EntityA = (uint32_t)contact->GetFixtureA()->GetBody()->GetUserData().pointer;
+			state.EntityB = (uint32_t)contact->GetFixtureB()->GetBody()->GetUserData().pointer;
+			state.ChildA = contact->GetChildIndexA();
+			state.ChildB = contact->GetChildIndexB();
+			state.PointCount = manifold->pointCount;
+			for (int32 i = 0; i < manifold->pointCount; i++)
+			{
+				state.NormalImpulse[i] = manifold->points[i].normalImpulse;
+				state.TangentImpulse[i] = manifold->points[i].tangentImpulse;
+			}
+			snapshot.Contacts.push_back(state);
+		}
+
+		std::sort(snapshot.Contacts.begin(), snapshot.Contacts.end());
+	}
+
+	static void ApplyBodyState(b2Body* body, const PhysicsBodyState& state)
+	{
+		body->SetTransform(b2Vec2(state.PositionX, state.PositionY), state.Angle);
+
+		// SetAwake(false)会把速度清零, 睡眠的b2Body速度本来就是0
+		body->SetAwake(state.Awake != 0);
+		if (state.Awake)
+		{
+			body->SetLinearVelocity(b2Vec2(state.LinearVelocityX, state.LinearVelocityY));
+			body->SetAngularVelocity(state.AngularVelocity);
+		}
+	}
+
+	void Physics2D::Restore(const PhysicsSnapshot& snapshot)
+	{
+		const std::vector<PhysicsBodyState>& states = snapshot.Bodies;
+
+		// 快速路径: 快照以后没有创建或删除过b2Body, body列表的顺序与快照一致, 按下标对应即可
+		size_t i = 0;
+		b2Body* body = m_World->GetBodyList();
+		for (; body; body = body->GetNext())
+		{
+			if (body->GetType() == b2_staticBody)
+				continue;
+
+			if (i >= states.size() || states[i].Entity != (uint32_t)body->GetUserData().pointer)
+				break;
+
+			ApplyBodyState(body, states[i++]);
+		}
+
+		// 慢速路径: 剩下的b2Body按entity查找
+		if (body)
+		{
+			std::unordered_map<uint32_t, const PhysicsBodyState*> lookup;
+			lookup.reserve(states.size() - i);
+			for (size_t j = i; j < states.size(); j++)
+				lookup[states[j].Entity] = &states[j];
+
+			for (; body; body = body->GetNext())
+			{
+				if (body->GetType() == b2_staticBody)
+					continue;
+
+				auto it = lookup.find((uint32_t)body->GetUserData().pointer);
+				if (it != lookup.end())
+					ApplyBodyState(body, *it->second);
+			}
+		}
+
+		// 接触本身由broadphase维护, 这里只把快照里的冲量写回仍然存在的接触上
+		for (b2Contact* contact = m_World->GetContactList(); contact; contact = contact->GetNext())
+		{
+			PhysicsContactState key = {};
+			key.EntityA = (uint32_t)contact->GetFixtureA()->GetBody()->GetUserData().pointer;
+			key.EntityB = (uint32_t)contact->GetFixtureB()->GetBody()->GetUserData().pointer;
+			key.ChildA = contact->GetChildIndexA();
+			key.ChildB = contact->GetChildIndexB();
+
+			auto it = std::lower_bound(snapshot.Contacts.begin(), snapshot.Contacts.end(), key);
+			b2Manifold* manifold = contact->GetManifold();
+			bool found = it != snapshot.Contacts.end() && !(key < *it) && it->PointCount == manifold->pointCount;
+			for (int32 p = 0; p < manifold->pointCount; p++)
+			{
+				manifold->points[p].normalImpulse = found ? it->NormalImpulse[p] : 0.0f;
+				manifold->points[p].tangentImpulse = found ? it->TangentImpulse[p] : 0.0f;
+			}
+		}
+
+		m_Tick = snapshot.Tick;
+	}
+
+	void Physics2D::EnableHistory(uint32_t capacity)
+	{
+		m_History.SetCapacity(capacity);
+	}
+
+	bool Physics2D::Rollback(uint64_t tick)
+	{
+		const PhysicsSnapshot* snapshot = m_History.Find(tick);
+		if (!snapshot)
+			return false;
+
+		Restore(*snapshot);
+		m_History.DiscardAfter(tick);
+		return true;
+	}
+
+	void Physics2D::Resimulate(uint32_t steps, const std::function<void(uint64_t)>& beforeStep)
+	{
+		for (uint32_t i = 0; i < steps; i++)
+		{
+			if (beforeStep)
+				beforeStep(m_Tick + 1);
+
+			Update();
+		}
+	}
+
+	uint32_t Physics2D::ConsumeSteps(float deltaTime)
+	{
+		m_Accumulator += deltaTime;
+
+		uint32_t steps = (uint32_t)(m_Accumulator / m_FixedTimeStep);
+		if (steps > m_MaxSubSteps)
+		{
+			steps = m_MaxSubSteps;
+			m_Accumulator = 0.0f;
+		}
+		else
+			m_Accumulator -= steps * m_FixedTimeStep;
+
+		// 浮点误差可能导致减完以后略小于0或略大于一步
+		m_Accumulator = std::min<float>(std::max<float>(m_Accumulator, 0.0f), m_FixedTimeStep);
+		return steps;
+	}
+
+	bool Physics2D::Raycast(const glm::vec2& from, const glm::vec2& to, PhysicsRaycastHit& outHit) const
+	{
+		// 长度为0的射线会触发Box2D里的断言
+		if (from == to)
+			return false;
+
+		ClosestRaycastCallback callback;
+		m_World->RayCast(&callback, b2Vec2(from.x, from.y), b2Vec2(to.x, to.y));
+		if (callback.Hit.Entity == entt::null)
+			return false;
+
+		outHit = callback.Hit;
+		return true;
+	}
+
+	void Physics2D::OverlapAABB(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& out) const
+	{
+		glm::vec2 center = (min + max) * 0.5f;
+		glm::vec2 half = (max - min) * 0.5f;
+
+		b2PolygonShape box;
+		box.SetAsBox(half.x, half.y, b2Vec2(center.x, center.y), 0.0f);
+
+		b2AABB aabb;
+		aabb.lowerBound.Set(min.x, min.y);
+		aabb.upperBound.Set(max.x, max.y);
+		Overlap(box, aabb, out);
+	}
+
+	void Physics2D::OverlapCircle(const glm::vec2& center, float radius, std::vector<entt::entity>& out) const
+	{
+		b2CircleShape circle;
+		circle.m_p.Set(center.x, center.y);
+		circle.m_radius = radius;
+
+		b2AABB aabb;
+		aabb.lowerBound.Set(center.x - radius, center.y - radius);
+		aabb.upperBound.Set(center.x + radius, center.y + radius);
+		Overlap(circle, aabb, out);
+	}
+
+	void Physics2D::Overlap(const b2Shape& shape, const b2AABB& aabb, std::vector<entt::entity>& out) const
+	{
+		std::vector<b2Fixture*> candidates;
+		QueryCandidates(aabb, candidates);
+		FilterOverlaps(shape, candidates, out);
+	}
+
+	void Physics2D::QueryCandidates(const b2AABB& aabb, std::vector<b2Fixture*>& out) const
+	{
+		CandidateCallback callback(out);
+		m_World->QueryAABB(&callback, aabb);
+	}
+
+	void Physics2D::FilterOverlaps(const b2Shape& shape, const std::vector<b2Fixture*>& candidates, std::vector<entt::entity>& out) const
+	{
+		size_t first = out.size();
+		{
+			std::lock_guard<std::mutex> lock(s_Box2DGlobalsMutex);
+			for (b2Fixture* fixture : candidates)
+			{
+				if (TestOverlap(shape, fixture))
+					out.push_back(GetEntity(fixture));
+			}
+		}
+
+		// 一个b2Body可能有多个Fixture, 去掉重复的entity
+		std::sort(out.begin() + first, out.end());
+		out.erase(std::unique(out.begin() + first, out.end()), out.end());
+	}
+
+	void Physics2D::RaycastBatch(const std::vector<PhysicsRay>& rays, std::vector<PhysicsRaycastHit>& outHits) const
+	{
+		outHits.assign(rays.size(), PhysicsRaycastHit());
+		JobSystem::ParallelFor(rays.size(), 0, [this, &rays, &outHits](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					Raycast(rays[i].From, rays[i].To, outHits[i]);
+			}, "Physics2D Raycast Batch");
+	}
+
+	void Physics2D::OverlapAABBBatch(const std::vector<std::pair<glm::vec2, glm::vec2>>& boxes, std::vector<std::vector<entt::entity>>& outResults) const
+	{
+		std::vector<std::vector<b2Fixture*>> candidates(boxes.size());
+		JobSystem::ParallelFor(boxes.size(), 0, [this, &boxes, &candidates](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					b2AABB aabb;
+					aabb.lowerBound.Set(boxes[i].first.x, boxes[i].first.y);
+					aabb.upperBound.Set(boxes[i].second.x, boxes[i].second.y);
+					QueryCandidates(aabb, candidates[i]);
+				}
+			}, "Physics2D OverlapAABB Batch");
+
+		// 精确测试在多个线程之间本来就是串行的, 直接在调用线程里做, 不在Worker之间抢锁
+		outResults.resize(boxes.size());
+		for (size_t i = 0; i < boxes.size(); i++)
+		{
+			glm::vec2 center = (boxes[i].first + boxes[i].second) * 0.5f;
+			glm::vec2 half = (boxes[i].second - boxes[i].first) * 0.5f;
+
+			b2PolygonShape box;
+			box.SetAsBox(half.x, half.y, b2Vec2(center.x, center.y), 0.0f);
+
+			outResults[i].clear();
+			FilterOverlaps(box, candidates[i], outResults[i]);
+		}
+	}
+
+	void Physics2D::OverlapCircleBatch(const std::vector<std::pair<glm::vec2, float>>& circles, std::vector<std::vector<entt::entity>>& outResults) const
+	{
+		std::vector<std::vector<b2Fixture*>> candidates(circles.size());
+		JobSystem::ParallelFor(circles.size(), 0, [this, &circles, &candidates](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const glm::vec2& center = circles[i].first;
+					float radius = circles[i].second;
+
+					b2AABB aabb;
+					aabb.lowerBound.Set(center.x - radius, center.y - radius);
+					aabb.upperBound.Set(center.x + radius, center.y + radius);
+					QueryCandidates(aabb, candidates[i]);
+				}
+			}, "Physics2D OverlapCircle Batch");
+
+		// 精确测试在多个线程之间本来就是串行的, 直接在调用线程里做, 不在Worker之间抢锁
+		outResults.resize(circles.size());
+		for (size_t i = 0; i < circles.size(); i++)
+		{
+			b2CircleShape circle;
+			circle.m_p.Set(circles[i].first.x, circles[i].first.y);
+			circle.m_radius = circles[i].second;
+
+			outResults[i].clear();
+			FilterOverlaps(circle, candidates[i], outResults[i]);
+		}
 	}
-}
\ No newline at end of file
+}
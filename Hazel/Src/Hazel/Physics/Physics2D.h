@@ -1,29 +1,119 @@
 #pragma once
 #include "box2d/box2d.h"
+#include "entt.hpp"
+#include "glm/glm.hpp"
+#include "PhysicsSnapshot.h"
+#include "PhysicsContactListener.h"
+#include <functional>
 #include <memory>
-#include "ECS/Components/Rigidbody2D.h"
+#include <vector>
 
 namespace Hazel
 {
-	class Collider2D;
-	class Rigidbody2D;
+	struct PhysicsRaycastHit
+	{
+		entt::entity Entity = entt::null;
+		glm::vec2 Point = { 0, 0 };
+		glm::vec2 Normal = { 0, 0 };
+		float Fraction = 1.0f;// 命中点在起点到终点之间的比例
+	};
+
+	struct PhysicsRay
+	{
+		glm::vec2 From;
+		glm::vec2 To;
+	};
 
-	// Pyhisics2DWorld
+	// 一个独立的2D物理世界, 每个Scene持有一个, 不同Scene之间的模拟互不影响, 可以在不同线程里调用Update
+	// Box2D的Step会写它自己的全局统计变量, 所以多个世界的Step在一把全局锁里串行执行, 见Physics2D.cpp
 	class Physics2D
 	{
 		static const int velocityIterations = 6;
 		static const int positionIterations = 2;
 
 	public:
-		static void Init(float gravityX = 0.0f, float gravityY = -10.0f);
-		static void Update();
-		static const std::shared_ptr<b2World>& GetWorld()  { return m_World; }
+		Physics2D(float gravityX = 0.0f, float gravityY = -10.0f);
+
+		Physics2D(const Physics2D&) = delete;
+		Physics2D& operator=(const Physics2D&) = delete;
+
+		// 按m_FixedTimeStep模拟一步
+		void Update();
+		b2World* GetWorld() const { return m_World.get(); }
+
+		void SetGravity(float gravityX, float gravityY) { m_World->SetGravity(b2Vec2(gravityX, gravityY)); }
+
+		// 丢弃整个b2World(连同其中所有的b2Body)并创建一个新的空世界, 重力不变
+		// 比逐个DestroyBody快得多, 新世界的内存池也是空的, 之后批量创建的b2Body在内存里是紧挨着的
+		void ResetWorld();
+
+		// 把这一帧的deltaTime累加起来, 返回这一帧需要模拟的步数, 调用者需要调用相应次数的Update
+		// 步数超过m_MaxSubSteps时, 多出来的时间直接丢弃(模拟会变慢), 否则单帧耗时会越来越长, 陷入死循环
+		uint32_t ConsumeSteps(float deltaTime);
+		// 累加器里剩下的、还不够一步的时间占一步的比例, 渲染时用它在上一步和当前步的状态之间插值
+		float GetInterpolationAlpha() const { return m_Accumulator / m_FixedTimeStep; }
+		void ResetAccumulator() { m_Accumulator = 0.0f; }
+
+		float GetFixedTimeStep() const { return m_FixedTimeStep; }
+		void SetFixedTimeStep(const float& fixedTimeStep) { m_FixedTimeStep = fixedTimeStep; }
 
-		static float GetFixedTimeStep() { return m_FixedTimeStep; }
-		static float SetFixedTimeStep(const float& fixedTimeStep) { m_FixedTimeStep = fixedTimeStep; }
+		uint32_t GetMaxSubSteps() const { return m_MaxSubSteps; }
+		void SetMaxSubSteps(uint32_t maxSubSteps) { m_MaxSubSteps = maxSubSteps; }
+
+		// Update期间产生的接触事件都缓冲在这里, 由使用者在Update之后批量读取; ClearContactEvents之前会一直累积
+		const std::vector<PhysicsContactEvent>& GetContactEvents() const { return m_ContactListener.GetEvents(); }
+		void ClearContactEvents() { m_ContactListener.Clear(); }
+		PhysicsContactListener& GetContactListener() { return m_ContactListener; }
+
+		// 已经模拟的步数, 每次Update加一, ResetWorld时归零
+		uint64_t GetTick() const { return m_Tick; }
+
+		// 把所有b2Body的位置、速度、睡眠状态以及接触的冲量记到snapshot里, 只读取物理世界
+		void Capture(PhysicsSnapshot& snapshot) const;
+		// 把snapshot里记录的状态写回对应的b2Body(按UserData里的entity对应), 快照之后才创建的b2Body保持不变
+		void Restore(const PhysicsSnapshot& snapshot);
+
+		// capacity大于0时, 每次Update之后都会把状态记到环形缓冲里, 用于回滚和回放
+		void EnableHistory(uint32_t capacity);
+		const PhysicsHistory& GetHistory() const { return m_History; }
+		// 回到第tick步模拟之后的状态, 之后的历史作废; tick已经不在缓冲里时返回false
+		bool Rollback(uint64_t tick);
+		// 从当前状态重新模拟steps步, 每步之前调用beforeStep(即将模拟的tick), 用来重新施加那一步的输入
+		void Resimulate(uint32_t steps, const std::function<void(uint64_t)>& beforeStep = nullptr);
+
+		// 以下查询都走b2World里的Dynamic Tree(broadphase), 再对候选的Fixture做精确测试, 返回b2Body所属的entity
+		// 查询只读取物理世界, 不能与Update同时进行
+		// 可以在多个线程里同时调用; Overlap的精确测试与所有世界的Step共用同一把锁, 在线程之间是串行的
+
+		// 从from到to的线段上最近的命中, 没有命中时返回false
+		bool Raycast(const glm::vec2& from, const glm::vec2& to, PhysicsRaycastHit& outHit) const;
+		// 与AABB或者圆相交的所有entity, 结果追加到out里, 同一个entity只出现一次
+		void OverlapAABB(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& out) const;
+		void OverlapCircle(const glm::vec2& center, float radius, std::vector<entt::entity>& out) const;
+
+		// 批量版本, 把查询分摊到JobSystem的Worker线程里并行执行, 结果与输入一一对应
+		// Overlap只有broadphase在Worker线程里并行, 精确测试在调用线程里完成
+		// outHits[i].Entity为entt::null表示第i条射线没有命中
+		void RaycastBatch(const std::vector<PhysicsRay>& rays, std::vector<PhysicsRaycastHit>& outHits) const;
+		void OverlapAABBBatch(const std::vector<std::pair<glm::vec2, glm::vec2>>& boxes, std::vector<std::vector<entt::entity>>& outResults) const;
+		void OverlapCircleBatch(const std::vector<std::pair<glm::vec2, float>>& circles, std::vector<std::vector<entt::entity>>& outResults) const;
 
 	private:
-		static std::shared_ptr<b2World> m_World;
-		static float m_FixedTimeStep;
+		// 用shape做精确测试的Overlap, OverlapAABB和OverlapCircle都转换成它
+		void Overlap(const b2Shape& shape, const b2AABB& aabb, std::vector<entt::entity>& out) const;
+		// 只走broadphase, 可以在多个线程里同时调用
+		void QueryCandidates(const b2AABB& aabb, std::vector<b2Fixture*>& out) const;
+		// 对broadphase的结果做精确测试, 通过的entity去重以后追加到out里
+		void FilterOverlaps(const b2Shape& shape, const std::vector<b2Fixture*>& candidates, std::vector<entt::entity>& out) const;
+
+	private:
+		PhysicsContactListener m_ContactListener;// 要比m_World后析构
+		std::unique_ptr<b2World> m_World;
+		float m_FixedTimeStep = 1.f / 120.f;
+		float m_Accumulator = 0.0f;
+		uint32_t m_MaxSubSteps = 8;
+
+		uint64_t m_Tick = 0;
+		PhysicsHistory m_History;
 	};
-}
\ No newline at end of file
+}
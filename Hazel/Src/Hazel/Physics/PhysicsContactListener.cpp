@@ -0,0 +1,64 @@
+#include "hzpch.h"
+#include "PhysicsContactListener.h"
+
+namespace Hazel
+{
+	PhysicsContactEvent& PhysicsContactListener::Push(PhysicsContactEventType type, b2Contact* contact)
+	{
+		PhysicsContactEvent& e = m_Events.emplace_back();
+		e.Type = type;
+		e.Tick = m_Tick;
+		e.EntityA = (entt::entity)contact->GetFixtureA()->GetBody()->GetUserData().pointer;
+		e.EntityB = (entt::entity)contact->GetFixtureB()->GetBody()->GetUserData().pointer;
+		e.NormalImpulse = 0.0f;
+		e.TangentImpulse = 0.0f;
+
+		// End事件时两个Fixture可能已经不再重叠, manifold里没有接触点
+		b2WorldManifold worldManifold;
+		contact->GetWorldManifold(&worldManifold);
+		bool hasPoint = contact->GetManifold()->pointCount > 0;
+		e.Point = hasPoint ? glm::vec2(worldManifold.points[0].x, worldManifold.points[0].y) : glm::vec2(0.0f);
+		e.Normal = hasPoint ? glm::vec2(worldManifold.normal.x, worldManifold.normal.y) : glm::vec2(0.0f);
+		return e;
+	}
+
+	void PhysicsContactListener::BeginContact(b2Contact* contact)
+	{
+		if (IsRecorded(PhysicsContactEventType::Begin))
+			Push(PhysicsContactEventType::Begin, contact);
+	}
+
+	void PhysicsContactListener::EndContact(b2Contact* contact)
+	{
+		if (IsRecorded(PhysicsContactEventType::End))
+			Push(PhysicsContactEventType::End, contact);
+	}
+
+	void PhysicsContactListener::PreSolve(b2Contact* contact, const b2Manifold* oldManifold)
+	{
+		if (IsRecorded(PhysicsContactEventType::PreSolve))
+			Push(PhysicsContactEventType::PreSolve, contact);
+	}
+
+	void PhysicsContactListener::PostSolve(b2Contact* contact, const b2ContactImpulse* impulse)
+	{
+		if (!IsRecorded(PhysicsContactEventType::PostSolve))
+			return;
+
+		// 先算冲量, 静止堆叠的物体每步都会有很小的冲量, 低于阈值的不记录
+		float normalImpulse = 0.0f;
+		float tangentImpulse = 0.0f;
+		for (int32 i = 0; i < impulse->count; i++)
+		{
+			normalImpulse = std::max<float>(normalImpulse, impulse->normalImpulses[i]);
+			tangentImpulse = std::max<float>(tangentImpulse, std::abs(impulse->tangentImpulses[i]));
+		}
+
+		if (normalImpulse < m_PostSolveThreshold)
+			return;
+
+		PhysicsContactEvent& e = Push(PhysicsContactEventType::PostSolve, contact);
+		e.NormalImpulse = normalImpulse;
+		e.TangentImpulse = tangentImpulse;
+	}
+}
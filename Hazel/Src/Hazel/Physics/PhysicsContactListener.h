@@ -0,0 +1,62 @@
+#pragma once
+#include "box2d/box2d.h"
+#include "entt.hpp"
+#include "glm/glm.hpp"
+#include <vector>
+
+namespace Hazel
+{
+	enum class PhysicsContactEventType : uint8_t
+	{
+		Begin		= 1 << 0,	// 两个Fixture开始接触
+		End			= 1 << 1,	// 两个Fixture分开, b2Body被删除时也会产生
+		PreSolve	= 1 << 2,	// 每一步求解之前, 每对正在接触的Fixture各一次
+		PostSolve	= 1 << 3	// 每一步求解之后, 带有这一步的冲量
+	};
+
+	struct PhysicsContactEvent
+	{
+		PhysicsContactEventType Type;
+		uint64_t Tick;// 产生这个事件的那一步模拟, 一帧里可能模拟多步
+		entt::entity EntityA;
+		entt::entity EntityB;
+		glm::vec2 Point;// 世界空间的接触点, 有多个接触点时取第一个
+		glm::vec2 Normal;// 从A指向B
+		float NormalImpulse;// 只有PostSolve有, 多个接触点时取最大值, 可以用来判断撞击的强度
+		float TangentImpulse;
+	};
+
+	// 不在Box2D的回调里执行任何游戏逻辑, 只把事件追加到缓冲里
+	// Scene的System和脚本在Physics2D这个System之后, 一次性批量处理本帧所有的事件
+	class PhysicsContactListener : public b2ContactListener
+	{
+	public:
+		// 要记录哪些类型的事件, 默认只记录Begin和End; PreSolve和PostSolve每步每对接触都会产生, 数量很大, 需要时再打开
+		void SetRecordedEvents(uint8_t mask) { m_Mask = mask; }
+		uint8_t GetRecordedEvents() const { return m_Mask; }
+		// 打开PostSolve以后, 只记录最大法向冲量不小于threshold的接触, 比如只关心撞击而不关心静止的堆叠
+		void SetPostSolveThreshold(float threshold) { m_PostSolveThreshold = threshold; }
+		float GetPostSolveThreshold() const { return m_PostSolveThreshold; }
+
+		void SetTick(uint64_t tick) { m_Tick = tick; }
+
+		const std::vector<PhysicsContactEvent>& GetEvents() const { return m_Events; }
+		// 只清空数据, 保留容量, 每帧不会重新分配内存
+		void Clear() { m_Events.clear(); }
+
+		void BeginContact(b2Contact* contact) override;
+		void EndContact(b2Contact* contact) override;
+		void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override;
+		void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override;
+
+	private:
+		bool IsRecorded(PhysicsContactEventType type) const { return (m_Mask & (uint8_t)type) != 0; }
+		PhysicsContactEvent& Push(PhysicsContactEventType type, b2Contact* contact);
+
+	private:
+		std::vector<PhysicsContactEvent> m_Events;
+		uint64_t m_Tick = 0;
+		uint8_t m_Mask = (uint8_t)PhysicsContactEventType::Begin | (uint8_t)PhysicsContactEventType::End;
+		float m_PostSolveThreshold = 0.0f;
+	};
+}
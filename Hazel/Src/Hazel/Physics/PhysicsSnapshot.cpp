@@ -0,0 +1,122 @@
+#include "hzpch.h"
+#include "PhysicsSnapshot.h"
+
+namespace Hazel
+{
+	static const uint32_t SNAPSHOT_MAGIC = 0x53505A48;// "HZPS"
+	static const uint32_t SNAPSHOT_VERSION = 1;
+
+	struct PhysicsSnapshotHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Tick;
+		uint32_t BodyCount;
+		uint32_t ContactCount;
+	};
+
+	void PhysicsSnapshot::Clear()
+	{
+		Tick = 0;
+		Bodies.clear();
+		Contacts.clear();
+	}
+
+	void PhysicsSnapshot::Serialize(std::vector<uint8_t>& out) const
+	{
+		PhysicsSnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, Tick, (uint32_t)Bodies.size(), (uint32_t)Contacts.size() };
+		size_t bodyBytes = Bodies.size() * sizeof(PhysicsBodyState);
+		size_t contactBytes = Contacts.size() * sizeof(PhysicsContactState);
+
+		size_t offset = out.size();
+		out.resize(offset + sizeof(header) + bodyBytes + contactBytes);
+		uint8_t* dst = out.data() + offset;
+
+		memcpy(dst, &header, sizeof(header));
+		if (bodyBytes)
+			memcpy(dst + sizeof(header), Bodies.data(), bodyBytes);
+		if (contactBytes)
+			memcpy(dst + sizeof(header) + bodyBytes, Contacts.data(), contactBytes);
+	}
+
+	bool PhysicsSnapshot::Deserialize(const uint8_t* data, size_t size)
+	{
+		PhysicsSnapshotHeader header;
+		if (size < sizeof(header))
+			return false;
+
+		memcpy(&header, data, sizeof(header));
+		if (header.Magic != SNAPSHOT_MAGIC || header.Version != SNAPSHOT_VERSION)
+			return false;
+
+		size_t bodyBytes = (size_t)header.BodyCount * sizeof(PhysicsBodyState);
+		size_t contactBytes = (size_t)header.ContactCount * sizeof(PhysicsContactState);
+		if (size < sizeof(header) + bodyBytes + contactBytes)
+			return false;
+
+		Tick = header.Tick;
+		Bodies.resize(header.BodyCount);
+		Contacts.resize(header.ContactCount);
+		if (bodyBytes)
+			memcpy(Bodies.data(), data + sizeof(header), bodyBytes);
+		if (contactBytes)
+			memcpy(Contacts.data(), data + sizeof(header) + bodyBytes, contactBytes);
+
+		return true;
+	}
+
+	void PhysicsHistory::SetCapacity(uint32_t capacity)
+	{
+		m_Ring.resize(capacity);
+		Clear();
+	}
+
+	PhysicsSnapshot& PhysicsHistory::Push(uint64_t tick)
+	{
+		HAZEL_ASSERT(!m_Ring.empty(), "PhysicsHistory has no capacity!");
+
+		PhysicsSnapshot& slot = m_Ring[m_Head];
+		slot.Clear();
+		slot.Tick = tick;
+
+		m_Head = (m_Head + 1) % (uint32_t)m_Ring.size();
+		m_Count = std::min<uint32_t>(m_Count + 1, (uint32_t)m_Ring.size());
+		return slot;
+	}
+
+	const PhysicsSnapshot& PhysicsHistory::At(uint32_t age) const
+	{
+		uint32_t capacity = (uint32_t)m_Ring.size();
+		return m_Ring[(m_Head + capacity - 1 - age) % capacity];
+	}
+
+	// 快照是按tick连续Push的, 可以直接算出下标
+	const PhysicsSnapshot* PhysicsHistory::Find(uint64_t tick) const
+	{
+		if (m_Count == 0 || tick > GetNewestTick() || tick < GetOldestTick())
+			return nullptr;
+
+		const PhysicsSnapshot& snapshot = At((uint32_t)(GetNewestTick() - tick));
+		return snapshot.Tick == tick ? &snapshot : nullptr;
+	}
+
+	uint64_t PhysicsHistory::GetOldestTick() const
+	{
+		return m_Count ? At(m_Count - 1).Tick : 0;
+	}
+
+	uint64_t PhysicsHistory::GetNewestTick() const
+	{
+		return m_Count ? At(0).Tick : 0;
+	}
+
+	void PhysicsHistory::DiscardAfter(uint64_t tick)
+	{
+		uint32_t capacity = (uint32_t)m_Ring.size();
+		while (m_Count > 0 && At(0).Tick > tick)
+		{
+			m_Head = (m_Head + capacity - 1) % capacity;
+			m_Count--;
+		}
+	}
+}
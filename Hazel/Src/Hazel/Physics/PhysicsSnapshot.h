@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Hazel
+{
+	// 单个b2Body在某一步模拟之后的完整运动状态, 全是POD, 可以直接按字节拷贝、写入网络包
+	struct PhysicsBodyState
+	{
+		uint32_t Entity;// b2Body的UserData里记录的entity
+		float PositionX, PositionY, Angle;
+		float LinearVelocityX, LinearVelocityY, AngularVelocity;
+		uint32_t Awake;
+	};
+
+	// 一对正在接触的Fixture的冲量, 还原后Box2D用它做warm starting, 重新模拟的结果才能与第一次一致
+	struct PhysicsContactState
+	{
+		uint32_t EntityA, EntityB;
+		int32_t ChildA, ChildB;
+		int32_t PointCount;
+		float NormalImpulse[2];
+		float TangentImpulse[2];
+
+		bool operator<(const PhysicsContactState& other) const
+		{
+			if (EntityA != other.EntityA) return EntityA < other.EntityA;
+			if (EntityB != other.EntityB) return EntityB < other.EntityB;
+			if (ChildA != other.ChildA) return ChildA < other.ChildA;
+			return ChildB < other.ChildB;
+		}
+	};
+
+	// 物理世界在第Tick步模拟之后的状态, 由Physics2D::Capture填充, Physics2D::Restore还原
+	// Bodies按b2World里body列表的顺序排列, 还原时如果列表没变可以按下标一一对应; Contacts按entity排序
+	class PhysicsSnapshot
+	{
+	public:
+		uint64_t Tick = 0;
+		std::vector<PhysicsBodyState> Bodies;
+		std::vector<PhysicsContactState> Contacts;
+
+		// 只清空数据, 保留vector的容量, 环形缓冲里的快照被覆盖时不会重新分配内存
+		void Clear();
+
+		// 紧凑的二进制格式: 头部 + 两个POD数组, 用于网络同步和录像
+		void Serialize(std::vector<uint8_t>& out) const;
+		bool Deserialize(const uint8_t* data, size_t size);
+	};
+
+	// 固定容量的快照环形缓冲, 最新的快照会覆盖最旧的
+	class PhysicsHistory
+	{
+	public:
+		void SetCapacity(uint32_t capacity);
+		uint32_t GetCapacity() const { return (uint32_t)m_Ring.size(); }
+		uint32_t GetCount() const { return m_Count; }
+
+		// 返回给tick用的快照槽位, 由调用者填充
+		PhysicsSnapshot& Push(uint64_t tick);
+		// 没有找到(太旧已经被覆盖, 或者还没有模拟到)时返回nullptr
+		const PhysicsSnapshot* Find(uint64_t tick) const;
+		uint64_t GetOldestTick() const;
+		uint64_t GetNewestTick() const;
+
+		// 回滚到tick以后, 之后的快照都作废, 重新模拟时会再次Push
+		void DiscardAfter(uint64_t tick);
+		void Clear() { m_Head = 0; m_Count = 0; }
+
+	private:
+		const PhysicsSnapshot& At(uint32_t age) const;// age为0是最新的快照
+
+	private:
+		std::vector<PhysicsSnapshot> m_Ring;
+		uint32_t m_Head = 0;// 下一个要写入的槽位
+		uint32_t m_Count = 0;
+	};
+}
@@ -18,6 +18,9 @@ namespace Hazel
 
     static MonoDomain* s_CSharpDomain;
 
+    // 按MonoClass缓存解析好的ScriptClass, unique_ptr保证返回给外面的地址不会因为rehash失效
+    static std::unordered_map<MonoClass*, std::unique_ptr<ScriptClass>> s_ScriptClasses;
+
     // 读取一个C# dll到Mono里, 然后返回对应的Assembly指针
     MonoAssembly* Scripting::LoadCSharpAssembly(const std::string& assemblyPath)
     {
@@ -122,7 +125,7 @@ namespace Hazel
     }
 
     // Mono gives us two ways of calling C# methods: mono_runtime_invoke and Unmanaged Method Thunks. 
-    // This Api will only cover mono_runtime_invoke
+    // This Api will only cover mono_runtime_invoke, thunks are cached in ScriptClass
     // Using mono_runtime_invoke is slower compared to Unmanaged Method Thunks, but it's also safe and more flexible. 
     // mono_runtime_invoke can invoke any method with any parameters, and from what I understand mono_runtime_invoke also does a lot more error checking and validation on the object you pass, as well as the parameters.
     void Scripting::CallMethod(MonoClass* monoClass, MonoObject* objectInstance, const char* methodName)
@@ -162,4 +165,80 @@ namespace Hazel
         // Get a reference to the public field called "MyPublicFloatVar"
         return mono_class_get_property_from_name(testingClass, propertyName);
     }
-}
\ No newline at end of file
+
+    template<class Thunk>
+    static Thunk GetMethodThunk(MonoClass* monoClass, const char* methodName, int paramCount)
+    {
+        MonoMethod* method = mono_class_get_method_from_name(monoClass, methodName, paramCount);
+        return method ? (Thunk)mono_method_get_unmanaged_thunk(method) : nullptr;
+    }
+
+    const ScriptClass* Scripting::GetScriptClass(MonoClass* monoClass)
+    {
+        if (!monoClass)
+            return nullptr;
+
+        auto it = s_ScriptClasses.find(monoClass);
+        if (it != s_ScriptClasses.end())
+            return it->second.get();
+
+        // 只有这里会按名字查找方法, 每个类一次
+        std::unique_ptr<ScriptClass> scriptClass = std::make_unique<ScriptClass>();
+        scriptClass->Class = monoClass;
+        scriptClass->OnCreate = GetMethodThunk<ScriptClass::OnCreateThunk>(monoClass, "OnCreate", 0);
+        scriptClass->OnUpdate = GetMethodThunk<ScriptClass::OnUpdateThunk>(monoClass, "OnUpdate", 1);
+        scriptClass->OnDestroy = GetMethodThunk<ScriptClass::OnDestroyThunk>(monoClass, "OnDestroy", 0);
+
+        return s_ScriptClasses.emplace(monoClass, std::move(scriptClass)).first->second.get();
+    }
+
+    // C#里抛出的异常不会传到C++这边, 打印出来即可
+    static void HandleScriptException(MonoException* exception)
+    {
+        if (exception)
+            mono_print_unhandled_exception((MonoObject*)exception);
+    }
+
+    void Scripting::InvokeOnCreate(const ScriptClass& scriptClass, MonoObject* instance)
+    {
+        if (!scriptClass.OnCreate)
+            return;
+
+        MonoException* exception = nullptr;
+        scriptClass.OnCreate(instance, &exception);
+        HandleScriptException(exception);
+    }
+
+    void Scripting::InvokeOnUpdate(const ScriptClass& scriptClass, MonoObject* instance, float ts)
+    {
+        if (!scriptClass.OnUpdate)
+            return;
+
+        MonoException* exception = nullptr;
+        scriptClass.OnUpdate(instance, ts, &exception);
+        HandleScriptException(exception);
+    }
+
+    void Scripting::InvokeOnUpdate(const ScriptClass& scriptClass, MonoObject* const* instances, size_t count, float ts)
+    {
+        if (!scriptClass.OnUpdate)
+            return;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            MonoException* exception = nullptr;
+            scriptClass.OnUpdate(instances[i], ts, &exception);
+            HandleScriptException(exception);
+        }
+    }
+
+    void Scripting::InvokeOnDestroy(const ScriptClass& scriptClass, MonoObject* instance)
+    {
+        if (!scriptClass.OnDestroy)
+            return;
+
+        MonoException* exception = nullptr;
+        scriptClass.OnDestroy(instance, &exception);
+        HandleScriptException(exception);
+    }
+}
@@ -2,9 +2,32 @@
 #include <string>
 #include "mono/metadata/image.h"
 #include "mono/jit/jit.h"
+#include "mono/metadata/object.h"
+
+// Windows上Unmanaged Method Thunk按__stdcall调用
+#ifdef HZ_PLATFORM_WINDOWS
+	#define HZ_MONO_THUNK_CALL __stdcall
+#else
+	#define HZ_MONO_THUNK_CALL
+#endif
 
 namespace Hazel
 {
+	// 脚本类里引擎会反复调用的方法, 每个类只按名字解析一次, 存成Unmanaged Method Thunk
+	// thunk就是普通的函数指针: 实例方法的第一个参数是this, 最后一个参数用来传出C#里抛出的异常
+	// 类里没有定义的方法对应的指针为nullptr
+	struct ScriptClass
+	{
+		using OnCreateThunk = void(HZ_MONO_THUNK_CALL*)(MonoObject* self, MonoException** exception);
+		using OnUpdateThunk = void(HZ_MONO_THUNK_CALL*)(MonoObject* self, float ts, MonoException** exception);
+		using OnDestroyThunk = void(HZ_MONO_THUNK_CALL*)(MonoObject* self, MonoException** exception);
+
+		MonoClass* Class = nullptr;
+		OnCreateThunk OnCreate = nullptr;// void OnCreate()
+		OnUpdateThunk OnUpdate = nullptr;// void OnUpdate(float ts)
+		OnDestroyThunk OnDestroy = nullptr;// void OnDestroy()
+	};
+
 	// 此类负责在C++端调用C#端的代码, 比如Call Method, 读写Property和Field的值等操作
 	// 类似于Unity, C#这边的脚本层分为核心层和用户层两块
 	// 核心层的代码(C#这边的源码)应该是和C++的代码会存在相互调用的情况的
@@ -22,9 +45,19 @@ namespace Hazel
 		// C++创建C#这边的对象
 		MonoObject* CreateInstance(MonoClass* p);
 
-		// C++调用C#这边的Method
+		// C++调用C#这边的Method, 每次都按名字查找, 适合偶尔的调用; 每帧的调用用下面的ScriptClass
 		void CallMethod(MonoClass* monoClass, MonoObject* instance, const char* methodName);
 
+		// 第一次用到monoClass时解析并缓存它的OnCreate、OnUpdate和OnDestroy, 之后直接返回缓存, 地址一直有效
+		// 应该在创建脚本实例时取一次并保存下来, 每帧调用的路径上不再有任何查找
+		const ScriptClass* GetScriptClass(MonoClass* monoClass);
+
+		void InvokeOnCreate(const ScriptClass& scriptClass, MonoObject* instance);
+		void InvokeOnUpdate(const ScriptClass& scriptClass, MonoObject* instance, float ts);
+		// 同一个类的所有实例依次调用OnUpdate
+		void InvokeOnUpdate(const ScriptClass& scriptClass, MonoObject* const* instances, size_t count, float ts);
+		void InvokeOnDestroy(const ScriptClass& scriptClass, MonoObject* instance);
+
 		// Field can be public or private
 		MonoClassField* GetFieldRef(MonoObject* instance, const char* fieldName);
 
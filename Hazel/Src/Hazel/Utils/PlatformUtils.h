@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <optional>
+#include <cstdint>
 
 namespace Hazel
 {
@@ -11,4 +12,28 @@ namespace Hazel
 		static std::optional<std::string> OpenFile(const char* filter);
 		static std::optional<std::string> SaveFile(const char* filter);
 	};
-}
\ No newline at end of file
+
+	// 把整个文件只读地映射到内存里, 读取时由操作系统按页加载, 不需要先拷贝到自己的buffer
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const char* path);
+		void Close();
+
+		bool IsOpen() const { return m_Data != nullptr; }
+		const uint8_t* GetData() const { return m_Data; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+	};
+}
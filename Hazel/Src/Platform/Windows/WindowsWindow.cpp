@@ -61,32 +61,28 @@ namespace Hazel
 			WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
 			data.height = height;
 			data.width = width;
-			// 创建对应的Hazel Event，然后传入Window的callback函数里，以供外部调用
-			WindowResizedEvent e(height, width);
-			data.eventCallback(e);
+			// 创建对应的Hazel Event，放进队列里，拖动窗口边缘时连续的Resize只会保留最后一个
+			data.eventQueue->Push<WindowResizedEvent>(height, width);
 		}
 		);
 
 		glfwSetCursorPosCallback(m_Window, [](GLFWwindow *window, double xPos, double yPos)
 		{
 			WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
-			MouseMovedEvent e((float)xPos, (float)yPos);
-			data.eventCallback(e);
+			data.eventQueue->Push<MouseMovedEvent>((float)xPos, (float)yPos);
 		}
 		);
 
 		glfwSetWindowCloseCallback(m_Window, [](GLFWwindow* window)
 		{
 			WindowData &data = *(WindowData*)glfwGetWindowUserPointer(window);
-			WindowCloseEvent closeEvent;
-			data.eventCallback(closeEvent);
+			data.eventQueue->Push<WindowCloseEvent>();
 		});
 
 		glfwSetScrollCallback(m_Window, [](GLFWwindow* window, double xOffset, double yOffset)
 		{
 			WindowData &data = *(WindowData*)glfwGetWindowUserPointer(window);
-			MouseScrolledEvent event((float)xOffset, (float)yOffset);
-			data.eventCallback(event);
+			data.eventQueue->Push<MouseScrolledEvent>((float)xOffset, (float)yOffset);
 		});
 
 		glfwSetMouseButtonCallback(m_Window, [](GLFWwindow* window, int button, int action, int mods)
@@ -96,15 +92,13 @@ namespace Hazel
 				case GLFW_PRESS:
 				{
 					WindowData &data = *(WindowData *)glfwGetWindowUserPointer(window);
-					MouseButtonPressedEvent e(button);
-					data.eventCallback(e);
+					data.eventQueue->Push<MouseButtonPressedEvent>(button);
 					break;
 				}
 				case GLFW_RELEASE:
 				{
 					WindowData &data = *(WindowData *)glfwGetWindowUserPointer(window);
-					MouseButtonReleasedEvent e(button);
-					data.eventCallback(e);
+					data.eventQueue->Push<MouseButtonReleasedEvent>(button);
 					break;
 				}
 				default:
@@ -119,20 +113,17 @@ namespace Hazel
 			{
 				case GLFW_PRESS:
 				{
-					KeyPressedEvent e(key, 0);
-					data.eventCallback(e);
+					data.eventQueue->Push<KeyPressedEvent>(key, 0);
 					break;
 				}
 				case GLFW_REPEAT:
 				{
-					KeyPressedEvent e(key, 1);
-					data.eventCallback(e);
+					data.eventQueue->Push<KeyPressedEvent>(key, 1);
 					break;
 				}
 				case GLFW_RELEASE:
 				{
-					KeyReleasedEvent e(key);
-					data.eventCallback(e);
+					data.eventQueue->Push<KeyReleasedEvent>(key);
 					break;
 				}
 				default:
@@ -145,8 +136,7 @@ namespace Hazel
 		glfwSetCharCallback(m_Window, [](GLFWwindow* window, unsigned int s)
 		{
 			WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
-			KeyTypedEvent e(s);
-			data.eventCallback(e);
+			data.eventQueue->Push<KeyTypedEvent>(s);
 		}
 		);
 	}
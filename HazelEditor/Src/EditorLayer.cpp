@@ -7,6 +7,7 @@
 #include <filesystem>
 #include "ECS/Components/Transform.h"
 #include "ECS/SceneSerializer.h"
+#include "ECS/BinarySceneSerializer.h"
 #include "Utils/PlatformUtils.h"
 #include "Hazel/Scripting/Scripting.h"
 #include "ImGuizmo.h"
@@ -88,7 +89,7 @@ namespace Hazel
 		camSpec.enableMSAA = m_EnableMSAATex;
 		m_CameraComponentFramebuffer = Hazel::Framebuffer::Create(camSpec);
 
-		SceneSerializer::Deserialize(m_Scene, "Physics.scene");
+		LoadSceneAsync("Physics.scene");
 		//SceneSerializer::Deserialize(m_Scene, "DefaultScene.scene");
 
 		m_SceneHierarchyPanel.SetContext(m_Scene);
@@ -122,6 +123,28 @@ namespace Hazel
 		CORE_LOG("Detach Layer");
 	}
 
+	void EditorLayer::LoadSceneAsync(const std::string& path)
+	{
+		m_SceneLoading = true;
+		m_SceneSaver.Reset();
+		m_ScenePath.clear();
+
+		// 解析在worker线程里, 之后每帧在OnUpdate开头合并一部分GameObject, 加载期间编辑器照常刷新
+		SceneSerializer::DeserializeAsync(m_Scene, path, 2.0f, nullptr, [this, path](bool success)
+			{
+				m_SceneLoading = false;
+				if (!success)
+				{
+					LOG_ERROR("Failed to load scene: " + path);
+					return;
+				}
+
+				// 烘焙过的二进制Scene只读, 不能增量保存
+				if (!SceneSerializer::IsBinaryScenePath(path))
+					m_ScenePath = path;
+			});
+	}
+
 	void EditorLayer::OnEvent(Hazel::Event& e)
 	{
 		if (e.GetEventType() == Hazel::EventType::KeyPressed)
@@ -147,6 +170,14 @@ namespace Hazel
 				m_Option = ToolbarOptions::Scale;
 				kpe->MarkHandled();
 			}
+
+			// Ctrl+S只把改过的GameObject追加写入, 不会重新写出整个Scene
+			if (kpe->GetKeycode() == HZ_KEY_S && Input::IsKeyPressed(HZ_KEY_LEFT_CONTROL))
+			{
+				if (m_Scene && !m_ScenePath.empty() && m_PlayMode == PlayMode::Edit && !m_SceneLoading)
+					m_SceneSaver.Save(m_Scene, m_ScenePath);
+				kpe->MarkHandled();
+			}
 		}
 		
 		if (e.GetEventType() == Hazel::EventType::MouseButtonPressed)
@@ -163,12 +194,22 @@ namespace Hazel
 						p.x = p.x - m_ViewportMin.x;
 						p.y = p.y - m_ViewportMin.y;
 
+						float width = m_ViewportMax.x - m_ViewportMin.x;
 						float height = m_ViewportMax.y - m_ViewportMin.y;
 						p.y = height - p.y;
 
-						int id = m_ViewportFramebuffer->ReadPixel(1, (int)p.x, (int)p.y);
-						if (id > -1)
-							m_SceneHierarchyPanel.SetSelectedGameObjectId((uint32_t)id);
+						// 不再从Framebuffer里ReadPixel(会让CPU等待GPU画完这一帧), 而是把鼠标反投影成近平面到远平面的射线,
+						// 再由Scene用SpatialIndex粗筛, 与每个Sprite自己所在的平面求交
+						glm::vec2 ndc = { p.x / width * 2.0f - 1.0f, p.y / height * 2.0f - 1.0f };
+						glm::mat4 invVP = glm::inverse(m_EditorCameraController.GetCamera().GetViewProjectionMatrix());
+						glm::vec4 nearPos = invVP * glm::vec4(ndc, -1.0f, 1.0f);
+						glm::vec4 farPos = invVP * glm::vec4(ndc, 1.0f, 1.0f);
+						nearPos /= nearPos.w;
+						farPos /= farPos.w;
+
+						Hazel::GameObject go;
+						if (m_Scene->PickGameObject(glm::vec3(nearPos), glm::vec3(farPos - nearPos), go))
+							m_SceneHierarchyPanel.SetSelectedGameObjectId(go.GetInstanceId());
 					}
 				}
 				
@@ -186,6 +227,9 @@ namespace Hazel
 
 	void EditorLayer::OnUpdate(const Hazel::Timestep& ts)
 	{
+		// 异步加载的Scene在这里合并, 此时没有任何System或者保存在访问Scene
+		SceneSerializer::PumpAsyncLoads();
+
 		if (m_PlayMode == PlayMode::Play)
 		{
 			// 更新游戏逻辑
@@ -195,6 +239,26 @@ namespace Hazel
 		if (m_ViewportFocused/* && m_ViewportHovered*/)
 			m_EditorCameraController.OnUpdate(ts);
 
+		// 按相机看到的范围流式加载格子, Play时以第一个CameraComponent为准
+		if (m_WorldPartition.IsOpen())
+		{
+			glm::mat4 viewProjection = m_EditorCameraController.GetCamera().GetViewProjectionMatrix();
+			if (m_PlayMode == PlayMode::Play)
+			{
+				auto cameras = m_Scene->GetGameObjectsByComponent<CameraComponent>();
+				if (!cameras.empty())
+				{
+					const CameraComponent& cam = m_Scene->GetComponentInGameObject<CameraComponent>(cameras[0]);
+					viewProjection = cam.GetProjectionMatrix() * glm::inverse(cameras[0].GetTransformMat());
+				}
+			}
+
+			m_WorldPartition.Update(viewProjection);
+		}
+
+		// 所有的World Matrix每帧只批量算一次, Viewport和CameraComponent的渲染共用
+		m_Scene->UpdateWorldMatrices();
+
 		// 每帧开始Clear
 
 		// This is for the color for default window 
@@ -208,7 +272,7 @@ namespace Hazel
 		Hazel::RenderCommand::Clear();
 
 		Hazel::RenderCommandRegister::BeginScene(m_EditorCameraController.GetCamera());
-		Render();
+		Render(m_EditorCameraController.GetCamera().GetViewProjectionMatrix());
 		Hazel::RenderCommandRegister::EndScene();
 		
 		m_ViewportFramebuffer->Unbind();
@@ -232,7 +296,7 @@ namespace Hazel
 				Hazel::CameraComponent& cam = m_Scene->GetComponentInGameObject<Hazel::CameraComponent>(go);
 
 				Hazel::RenderCommandRegister::BeginScene(cam, go.GetTransformMat());
-				Render();
+				Render(cam.GetProjectionMatrix() * glm::inverse(go.GetTransformMat()));
 				Hazel::RenderCommandRegister::EndScene();
 			}
 
@@ -304,7 +368,13 @@ namespace Hazel
 			{
 				if (ImGui::BeginMenu("File"))
 				{
-					if (ImGui::MenuItem("Save Scene"))
+					// 异步加载期间Scene只有一部分GameObject, 不能保存、烘焙, 也不能再次加载
+					// Play期间加载的Scene会在Stop时被编辑状态的快照覆盖掉, 只允许在编辑模式下加载
+					bool sceneReady = m_Scene && !m_SceneLoading;
+					bool canLoad = sceneReady && m_PlayMode == PlayMode::Edit;
+
+					// 流式加载的世界里只有相机附近的格子, 保存出来的Scene是不完整的
+					if (ImGui::MenuItem("Save Scene", nullptr, false, sceneReady && !m_WorldPartition.IsOpen()))
 					{
 						// 返回的是绝对路径
 						std::optional<std::string> filePath = FileDialogWindowUtils::SaveFile("Hazel Scene (*.scene)\0*.scene\0");
@@ -317,27 +387,84 @@ namespace Hazel
 								path = path + ".scene";
 
 							if (m_Scene)
+							{
+								// 先等后台压缩结束, 否则它可能在完整写出之后才把旧的内容替换到同一个路径上
+								m_SceneSaver.Reset();
 								SceneSerializer::Serialize(m_Scene, path.c_str());
+								m_ScenePath = path;
+							}
 						}
 					}
 
-					if (ImGui::MenuItem("Load Scene"))
+					if (ImGui::MenuItem("Load Scene", nullptr, false, canLoad))
 					{
 						if (m_Scene)
 						{
-							std::optional<std::string> filePath = FileDialogWindowUtils::OpenFile("Hazel Scene (*.scene)\0*.scene\0");
+							std::optional<std::string> filePath = FileDialogWindowUtils::OpenFile("Hazel Scene (*.scene;*.hscene)\0*.scene;*.hscene\0");
 							if (filePath.has_value())
 							{
 								// 前面的Hazel Scene(*.scene)是展示在filter里的text, 后面的*.scene代表显示的文件后缀类型
-								if (m_Scene)
+								if (m_Scene && !m_SceneLoading && m_PlayMode == PlayMode::Edit)
 								{
+									m_WorldPartition.Close();
+									m_WorldPath.clear();
 									m_Scene->Clear();
-									SceneSerializer::Deserialize(m_Scene, filePath.value().c_str());
+									LoadSceneAsync(filePath.value());
 								}
 							}
 						}
 					}
 
+					// 把当前Scene烘焙成发布版使用的二进制格式
+					if (ImGui::MenuItem("Cook Scene", nullptr, false, sceneReady))
+					{
+						std::optional<std::string> filePath = FileDialogWindowUtils::SaveFile("Hazel Cooked Scene (*.hscene)\0*.hscene\0");
+
+						if (filePath.has_value())
+						{
+							std::string path = filePath.value();
+
+							if (!hasEnding(path, ".hscene"))
+								path = path + ".hscene";
+
+							if (m_Scene)
+								BinarySceneSerializer::Serialize(m_Scene, path.c_str());
+						}
+					}
+
+					// 把当前Scene按64x64的格子切开, 开放世界的地图运行时只加载相机附近的格子
+					if (ImGui::MenuItem("Build World Partition", nullptr, false, sceneReady))
+					{
+						std::optional<std::string> filePath = FileDialogWindowUtils::SaveFile("Hazel World (*.world)\0*.world\0");
+
+						if (filePath.has_value())
+						{
+							std::string path = filePath.value();
+
+							if (!hasEnding(path, ".world"))
+								path = path + ".world";
+
+							if (m_Scene)
+								WorldPartition::Build(m_Scene, path, 64.0f);
+						}
+					}
+
+					// 格子是烘焙过的数据, 打开以后的修改不能保存
+					if (ImGui::MenuItem("Open World Partition", nullptr, false, canLoad))
+					{
+						std::optional<std::string> filePath = FileDialogWindowUtils::OpenFile("Hazel World (*.world)\0*.world\0");
+						if (filePath.has_value() && m_Scene && !m_SceneLoading && m_PlayMode == PlayMode::Edit)
+						{
+							m_WorldPartition.Close();
+							m_Scene->Clear();
+							m_SceneSaver.Reset();
+							m_ScenePath.clear();
+							m_WorldPath.clear();
+							if (m_WorldPartition.Open(m_Scene, filePath.value()))
+								m_WorldPath = filePath.value();
+						}
+					}
+
 					ImGui::EndMenu();
 				}
 				ImGui::EndMainMenuBar();
@@ -353,6 +480,10 @@ namespace Hazel
 			ImGui::Text("DrawVertices: %d", stats.DrawVerticesCnt());
 			ImGui::Text("DrawTiangles: %d", stats.DrawTrianglesCnt());
 
+			ImGui::Separator();
+			for (auto& timing : m_Scene->GetSystemTimings())
+				ImGui::Text("%s: %.3f ms", timing.Name, timing.Milliseconds);
+
 			ImGui::Checkbox("Show Camera Component Window", &m_ShowCameraComponent);
 		}
 		ImGui::End();
@@ -456,17 +587,12 @@ namespace Hazel
 
 
 	// 此函数会为每个fbo都调用一次, 比如为Viewport和每个CameraComponent都调用一次
-	void EditorLayer::Render()
+	// 每次按对应相机的ViewProjection重新剔除, 只绘制看得到的Sprite
+	void EditorLayer::Render(const glm::mat4& viewProjection)
 	{
-		std::vector<GameObject> gos = m_Scene->GetGameObjectsByComponent<Hazel::SpriteRenderer>();
-
-		for (size_t i = 0; i < gos.size(); i++)
-		{
-			Hazel::GameObject& go = gos[i];
-			Hazel::SpriteRenderer& sRenderer = go.GetComponent<Hazel::SpriteRenderer>();
-			Hazel::Transform& t = go.GetComponent<Hazel::Transform>();
-			Hazel::RenderCommandRegister::DrawSpriteRenderer(sRenderer, t.GetTransformMat(), go.GetInstanceId());
-		}
+		m_Scene->ExtractRenderProxies(viewProjection);
+		for (const Hazel::SpriteRenderProxy& proxy : m_Scene->GetSpriteRenderProxies())
+			Hazel::RenderCommandRegister::DrawSpriteRenderer(*proxy.Sprite, proxy.World, proxy.InstanceId);
 	}
 
 	static ImGuizmo::OPERATION mCurrentGizmoOperation(ImGuizmo::TRANSLATE);
@@ -563,6 +689,14 @@ namespace Hazel
 
 	void EditorLayer::OnScenePlay()
 	{
+		if (m_SceneLoading)
+			return;
+
+		// 保存编辑状态, Stop时还原, 否则Play期间物理模拟会把GameObject永久移走
+		// 流式加载的世界在Play期间会增删格子, 快照对不上, Stop时直接重新打开
+		if (!m_WorldPartition.IsOpen())
+			m_EditSnapshot = m_Scene->Snapshot();
+
 		m_PlayMode = PlayMode::Play;
 		m_Scene->Begin();
 	}
@@ -571,5 +705,18 @@ namespace Hazel
 	{
 		m_PlayMode = PlayMode::Edit;
 		m_Scene->Stop();
+
+		if (m_WorldPartition.IsOpen())
+		{
+			m_WorldPartition.Close();
+			m_Scene->Clear();
+			m_WorldPartition.Open(m_Scene, m_WorldPath);
+		}
+
+		if (m_EditSnapshot)
+		{
+			m_Scene->Restore(*m_EditSnapshot);
+			m_EditSnapshot.reset();
+		}
 	}
 }	
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "Hazel.h"
 #include "Renderer/Framebuffer.h"
 #include "ContentBrowserPanel.h"
+#include "ECS/IncrementalSceneSaver.h"
+#include "ECS/WorldPartition.h"
 #include "imgui.h"
 
 namespace Hazel
@@ -22,13 +24,14 @@ namespace Hazel
 		void OnEvent(Hazel::Event&) override;
 		void OnUpdate(const Hazel::Timestep&) override;
 		void OnImGuiRender() override;
-		void Render();
+		void Render(const glm::mat4& viewProjection);
 
 	private:
 		void DrawUIToolbar();
 		void EditTransform(float* cameraView, float* cameraProjection, float* matrix, bool editTransformDecomposition);
 		void OnScenePlay();
 		void OnSceneStop();
+		void LoadSceneAsync(const std::string& path);
 
 	private:
 
@@ -41,6 +44,12 @@ namespace Hazel
 		// framebuffer数组, 每个元素对应一个CameraComponent
 		std::shared_ptr<Hazel::Framebuffer> m_CameraComponentFramebuffer;
 		std::shared_ptr<Hazel::Scene> m_Scene;
+		std::shared_ptr<const Hazel::SceneSnapshot> m_EditSnapshot;// Play之前的编辑状态
+		std::string m_ScenePath;// 当前Scene对应的YAML文件, Ctrl+S保存到这里
+		IncrementalSceneSaver m_SceneSaver;
+		bool m_SceneLoading = false;// DeserializeAsync还没有完成, 这期间不能保存或者再次加载
+		WorldPartition m_WorldPartition;// 打开*.world以后, Scene里只有相机附近的格子
+		std::string m_WorldPath;
 
 		glm::vec4 m_FlatColor = glm::vec4(0.2, 0.3, 0.8, 1.0);
 		glm::vec2 m_LastViewportSize = { 800, 600 };